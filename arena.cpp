@@ -0,0 +1,65 @@
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "arena.h"
+
+static char *align_up(char *ptr, size_t alignment) {
+  return (char *)(((uintptr_t)ptr + alignment - 1) &
+                  ~(uintptr_t)(alignment - 1));
+}
+
+Arena::~Arena() { this->reset(); }
+
+void *Arena::allocate(size_t size, size_t alignment) {
+  if (this->cursor != nullptr) {
+    char *aligned = align_up(this->cursor, alignment);
+    if (aligned + size <= this->end) {
+      this->cursor = aligned + size;
+      this->used += size;
+      return aligned;
+    }
+  }
+
+  // Oversized requests get a chunk of their own so the remainder of the
+  // current chunk is not thrown away for them.
+  size_t new_chunk_size = this->chunk_size;
+  bool dedicated = size + alignment > this->chunk_size;
+  if (dedicated)
+    new_chunk_size = size + alignment;
+
+  char *chunk = (char *)std::malloc(new_chunk_size);
+  if (chunk == nullptr)
+    throw std::bad_alloc();
+
+  this->chunks.push_back(chunk);
+  this->reserved += new_chunk_size;
+  this->used += size;
+
+  char *aligned = align_up(chunk, alignment);
+  if (!dedicated) {
+    this->cursor = aligned + size;
+    this->end = chunk + new_chunk_size;
+  }
+  return aligned;
+}
+
+std::string_view Arena::copy_string(std::string_view str) {
+  if (str.empty())
+    return std::string_view();
+
+  char *data = (char *)this->allocate(str.size(), 1);
+  std::memcpy(data, str.data(), str.size());
+  return std::string_view(data, str.size());
+}
+
+void Arena::reset() {
+  for (char *chunk : this->chunks)
+    std::free(chunk);
+
+  this->chunks.clear();
+  this->cursor = nullptr;
+  this->end = nullptr;
+  this->used = 0;
+  this->reserved = 0;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/*
+  Bump allocator that hands out memory from large chunks and releases
+  everything at once when it is reset or destroyed. Objects placed in the
+  arena never have their destructors run, so anything allocated here must
+  only own memory that also comes from the arena.
+*/
+class Arena {
+public:
+  Arena(size_t chunk_size = 64 * 1024) : chunk_size(chunk_size) {}
+  ~Arena();
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  void *allocate(size_t size, size_t alignment);
+
+  template <typename T, typename... Args> T *make(Args &&...args) {
+    return new (this->allocate(sizeof(T), alignof(T)))
+        T(std::forward<Args>(args)...);
+  }
+
+  std::string_view copy_string(std::string_view str);
+
+  void reset();
+
+  size_t bytes_used() const { return this->used; }
+  size_t bytes_reserved() const { return this->reserved; }
+  size_t chunk_count() const { return this->chunks.size(); }
+
+private:
+  size_t chunk_size;
+  std::vector<char *> chunks;
+  char *cursor = nullptr;
+  char *end = nullptr;
+  size_t used = 0;
+  size_t reserved = 0;
+};
+
+/*
+  Standard allocator over an Arena, for containers that live inside arena
+  allocated objects. Deallocation is a no-op, storage is reclaimed together
+  with the rest of the arena.
+*/
+template <typename T> class ArenaAllocator {
+public:
+  using value_type = T;
+
+  ArenaAllocator(Arena *arena) : arena(arena) {}
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+  T *allocate(size_t count) {
+    return (T *)this->arena->allocate(count * sizeof(T), alignof(T));
+  }
+
+  void deallocate(T *, size_t) {}
+
+  template <typename U> bool operator==(const ArenaAllocator<U> &other) const {
+    return this->arena == other.arena;
+  }
+
+  Arena *arena;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
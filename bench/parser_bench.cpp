@@ -0,0 +1,222 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+
+#include "flat_ast.h"
+#include "lexer.h"
+#include "parser.h"
+#include "sema.h"
+#include "session.h"
+
+/*
+  Front end benchmark. Generates orc programs, typical code as well as
+  inputs that used to take the parser down such as very long expressions
+  and deeply nested blocks, and reports how long lexing, parsing and the
+  semantic pass take on each of them and the resulting tokens per second,
+  followed by the time spent flattening the checked AST.
+
+  Usage: parser_bench [scale], where scale multiplies the size of every
+  input that is not bounded by the parser's nesting limit.
+*/
+
+struct BenchInput {
+  std::string name;
+  std::string source;
+};
+
+// Declarations with large array initializers.
+static std::string declarations(size_t count, size_t array_length) {
+  std::string source = "func main() int {\n";
+
+  for (size_t i = 0; i < count; ++i) {
+    source += "  var a" + std::to_string(i) + " int[] = {";
+    for (size_t j = 0; j < array_length; ++j)
+      source += (j == 0 ? "" : ",") + std::to_string(j);
+    source += "};\n";
+  }
+
+  return source + "  return(0);\n}\n";
+}
+
+// Many small functions mixing structs, loops, conditionals and calls.
+static std::string mixed_program(size_t functions) {
+  std::string source = "struct Point { x int, y int }\n";
+
+  for (size_t i = 0; i < functions; ++i) {
+    source += "func f" + std::to_string(i) + "(n int) int {\n"
+              "  var p Point = Point(n, n * 2);\n"
+              "  var total int = 0;\n"
+              "  var i int = 0;\n"
+              "  while (i < n) {\n"
+              "    if (i % 3 == 0) {\n"
+              "      total = total + p.x * i - p.y / 2;\n"
+              "    } else {\n"
+              "      total = total - 1;\n"
+              "    }\n"
+              "    i = i + 1;\n"
+              "  }\n"
+              "  printf(\"%d %s\\n\", total, \"done\");\n"
+              "  return(total);\n"
+              "}\n";
+  }
+
+  return source + "func main() int {\n  return(f0(10));\n}\n";
+}
+
+static std::string long_expression(size_t terms) {
+  std::string source = "func main() int {\n  return(1";
+  const char *ops[] = {" + ", " * ", " - ", " / ", " % "};
+
+  for (size_t i = 1; i < terms; ++i) {
+    source += ops[i % 5];
+    source += std::to_string(i % 9 + 1);
+  }
+
+  return source + ");\n}\n";
+}
+
+static std::string nested_blocks(size_t depth) {
+  std::string source = "func main() int {\n  var x int = 0;\n";
+
+  for (size_t i = 0; i < depth; ++i)
+    source += "if (x < 1) {\n";
+  source += "x = x + 1;\n";
+  for (size_t i = 0; i < depth; ++i)
+    source += "}\n";
+
+  return source + "  return(x);\n}\n";
+}
+
+static std::string nested_parens(size_t depth) {
+  return "func main() int {\n  return(" + std::string(depth, '(') + "1" +
+         std::string(depth, ')') + ");\n}\n";
+}
+
+// Best of `runs` timings of lexing, parsing and checking `path`, in ms, and
+// of flattening the result in `flatten_ms`.
+static double time_front_end(const std::string &path, int runs,
+                             size_t &token_count, double &flatten_ms) {
+  double best_ms = 0;
+
+  for (int run = 0; run < runs; ++run) {
+    auto start = std::chrono::steady_clock::now();
+
+    CompilationSession session;
+    if (!session.source.open(path)) {
+      printf("Error! Could not read `%s`\n", path.c_str());
+      exit(1);
+    }
+
+    Lexer lexer(session.source.view(), &session.interner);
+    TokenStream &tokens = lexer.lex();
+
+    Parser parser(&tokens, &session);
+    AST_Node *ast = parser.parse();
+
+    Sema sema(session.interner, session.types);
+    sema.check(ast);
+
+    auto checked = std::chrono::steady_clock::now();
+    FlatAST flat_ast = FlatAST::build(ast, session.interner);
+
+    std::chrono::duration<double, std::milli> elapsed = checked - start;
+    std::chrono::duration<double, std::milli> flatten =
+        std::chrono::steady_clock::now() - checked;
+
+    token_count = tokens.size();
+    if (run == 0 || elapsed.count() < best_ms)
+      best_ms = elapsed.count();
+    if (run == 0 || flatten.count() < flatten_ms)
+      flatten_ms = flatten.count();
+  }
+
+  return best_ms;
+}
+
+// Best of `runs` timings of hashing `path` and mapping its saved flat AST,
+// in ms, which is what replaces the front end for an unchanged source.
+static double time_cached_ast(const std::string &path, int runs) {
+  llvm::SmallString<128> ast_path;
+  if (llvm::sys::fs::createTemporaryFile("parser_bench", "ast", ast_path)) {
+    printf("Error! Could not create a temporary file.\n");
+    exit(1);
+  }
+
+  {
+    CompilationSession session;
+    session.source.open(path);
+    Lexer lexer(session.source.view(), &session.interner);
+    Parser parser(&lexer.lex(), &session);
+    AST_Node *ast = parser.parse();
+    Sema(session.interner, session.types).check(ast);
+    FlatAST::build(ast, session.interner)
+        .save(ast_path.str().str(), FlatAST::source_key(session.source.view()));
+  }
+
+  double best_ms = 0;
+  for (int run = 0; run < runs; ++run) {
+    auto start = std::chrono::steady_clock::now();
+
+    SourceFile source;
+    source.open(path);
+    std::optional<FlatAST> flat_ast =
+        FlatAST::map(ast_path.str().str(), FlatAST::source_key(source.view()));
+    if (!flat_ast) {
+      printf("Error! Could not map the saved AST of `%s`\n", path.c_str());
+      exit(1);
+    }
+
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (run == 0 || elapsed.count() < best_ms)
+      best_ms = elapsed.count();
+  }
+
+  llvm::sys::fs::remove(ast_path);
+  return best_ms;
+}
+
+int main(int argc, char **argv) {
+  size_t scale = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1;
+  if (scale == 0)
+    scale = 1;
+
+  std::vector<BenchInput> inputs = {
+      {"declarations", declarations(1000 * scale, 100)},
+      {"mixed program", mixed_program(2000 * scale)},
+      {"long expression", long_expression(100000 * scale)},
+      {"nested blocks", nested_blocks(2000)},
+      {"nested parens", nested_parens(4000)},
+  };
+
+  printf("%-20s %10s %10s %14s %13s %13s\n", "input", "tokens", "time (ms)",
+         "tokens/s", "flatten (ms)", "cached (ms)");
+
+  for (BenchInput &input : inputs) {
+    llvm::SmallString<128> path;
+    if (llvm::sys::fs::createTemporaryFile("parser_bench", "orc", path)) {
+      printf("Error! Could not create a temporary file.\n");
+      return 1;
+    }
+
+    std::ofstream(path.str().str()) << input.source;
+
+    size_t token_count = 0;
+    double flatten_ms = 0;
+    double ms = time_front_end(path.str().str(), 5, token_count, flatten_ms);
+    double cached_ms = time_cached_ast(path.str().str(), 5);
+    llvm::sys::fs::remove(path);
+
+    printf("%-20s %10zu %10.3f %14.0f %13.3f %13.3f\n", input.name.c_str(),
+           token_count, ms, token_count / (ms / 1000), flatten_ms, cached_ms);
+  }
+
+  return 0;
+}
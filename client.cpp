@@ -0,0 +1,65 @@
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "daemon_protocol.h"
+
+/*
+  Thin client for `orc --daemon`. Hands its working directory, arguments
+  and standard streams to the daemon listening on `socket`, which compiles
+  as `orc` would and writes to those streams directly, then exits with the
+  status of the compile. It links no LLVM, so it starts in no time.
+*/
+static const char *USAGE = "Usage: orc_client socket [orc arguments...]\n"
+                           "       orc_client socket --daemon-stats\n";
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    printf("%s", USAGE);
+    return 1;
+  }
+
+  int fd = daemon_connect(argv[1]);
+  if (fd < 0) {
+    printf("Error! Could not connect to an orc daemon on `%s`\n", argv[1]);
+    return 1;
+  }
+
+  std::vector<char> cwd(4096);
+  if (getcwd(cwd.data(), cwd.size()) == nullptr) {
+    printf("Error! Could not get the working directory.\n");
+    return 1;
+  }
+
+  DaemonRequest request;
+  std::vector<std::string> strings = {cwd.data()};
+  if (argc == 3 && std::string(argv[2]) == "--daemon-stats")
+    request.kind = DAEMON_STATS;
+  else
+    strings.insert(strings.end(), argv + 2, argv + argc);
+
+  if (!daemon_send_request(fd, request, strings)) {
+    printf("Error! Could not send the request to the orc daemon.\n");
+    return 1;
+  }
+
+  if (request.kind == DAEMON_STATS) {
+    uint32_t size = 0;
+    std::string report;
+    if (daemon_read_all(fd, &size, sizeof(size))) {
+      report.resize(size);
+      if (daemon_read_all(fd, report.data(), size)) {
+        printf("%s", report.c_str());
+        return 0;
+      }
+    }
+  } else {
+    uint32_t exit_code = 0;
+    if (daemon_read_all(fd, &exit_code, sizeof(exit_code)))
+      return exit_code;
+  }
+
+  printf("Error! The orc daemon hung up before replying.\n");
+  return 1;
+}
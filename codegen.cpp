@@ -0,0 +1,822 @@
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <string>
+#include <vector>
+
+#include "codegen.h"
+#include "compile_error.h"
+
+/*
+  A printf format string split at its conversions. `spec` is 0 for literal
+  text, `%%` is folded into the surrounding text.
+*/
+struct FormatPiece {
+  char spec = 0;
+  std::string text;
+};
+
+// Returns false when the format uses anything the output runtime does not
+// handle: flags, widths, precisions, length modifiers or other conversions.
+static bool parse_format(std::string_view format,
+                         std::vector<FormatPiece> &pieces) {
+  for (size_t i = 0; i < format.size(); ++i) {
+    if (format[i] != '%') {
+      if (pieces.empty() || pieces.back().spec != 0)
+        pieces.emplace_back();
+      pieces.back().text += format[i];
+      continue;
+    }
+
+    if (++i == format.size())
+      return false;
+
+    char spec = format[i];
+    if (spec == '%') {
+      if (pieces.empty() || pieces.back().spec != 0)
+        pieces.emplace_back();
+      pieces.back().text += '%';
+    } else if (spec == 'd' || spec == 'i' || spec == 'c' || spec == 's') {
+      pieces.push_back({spec, ""});
+    } else {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool format_accepts(char spec, const FlatType &type) {
+  if (spec == 's')
+    return type.type_kind() == ORC_TYPE_STRING;
+  if (spec == 'c')
+    return type.type_kind() == ORC_TYPE_INT;
+  return type.type_kind() == ORC_TYPE_INT || type.type_kind() == ORC_TYPE_BOOL;
+}
+
+static llvm::FunctionCallee
+runtime_function(llvm::Module &module, llvm::IRBuilder<> &builder,
+                 const char *name, llvm::ArrayRef<llvm::Type *> params) {
+  return module.getOrInsertFunction(
+      name, llvm::FunctionType::get(builder.getInt32Ty(), params, false));
+}
+
+// Operators that lower both of their operands as values. Assignment,
+// indexing and field access work on addresses instead.
+static bool is_value_operator(BinaryOp op) {
+  return op != BINARY_OP_ASSIGN && op != BINARY_OP_INDEX &&
+         op != BINARY_OP_ACCESSOR;
+}
+
+static llvm::Value *emit_value_operator(BinaryOp op, llvm::IRBuilder<> &builder,
+                                        llvm::Value *lhs, llvm::Value *rhs) {
+  switch (op) {
+  case BINARY_OP_ADD:
+    return builder.CreateAdd(lhs, rhs);
+
+  case BINARY_OP_SUBTRACT:
+    return builder.CreateSub(lhs, rhs);
+
+  case BINARY_OP_MULTIPLY:
+    return builder.CreateMul(lhs, rhs);
+
+  case BINARY_OP_DIVIDE:
+    return builder.CreateSDiv(lhs, rhs);
+
+  case BINARY_OP_MODULO:
+    return builder.CreateSRem(lhs, rhs);
+
+  case BINARY_OP_GREATER:
+    return builder.CreateICmpSGT(lhs, rhs);
+
+  case BINARY_OP_LESS:
+    return builder.CreateICmpSLT(lhs, rhs);
+
+  case BINARY_OP_EQUALS:
+    return builder.CreateICmpEQ(lhs, rhs);
+
+  default:
+    return nullptr;
+  }
+}
+
+/* ProgramSignatures */
+
+ProgramSignatures ProgramSignatures::build(const FlatAST &ast) {
+  ProgramSignatures signatures;
+
+  for (NodeIndex index : ast.children(ast.node(ast.root()))) {
+    const FlatNode &node = ast.node(index);
+
+    if (node.node_type() == AST_FUNCTION_DEFINITION) {
+      signatures.functions.push_back(index);
+      signatures.function_nodes.insert(node.a) = index;
+    } else if (node.node_type() == AST_NODE_BLOCK) {
+      signatures.structs.push_back(index);
+    }
+  }
+
+  return signatures;
+}
+
+/* Dispatch */
+
+void Codegen::emit_unit(std::span<const NodeIndex> functions) {
+  for (NodeIndex index : this->signatures.structs)
+    this->emit(index);
+
+  for (NodeIndex index : functions)
+    this->emit(index);
+}
+
+llvm::Value *Codegen::emit(NodeIndex index) {
+  const FlatNode &node = this->ast.node(index);
+
+  switch (node.node_type()) {
+  case AST_NODE_INTEGER_LITERAL:
+    return this->builder.getInt32(node.a);
+  case AST_NODE_STRING_LITERAL:
+    return this->emit_string_literal(node);
+  case AST_NODE_VARIABLE_REFERENCE:
+    return this->emit_variable_reference(node);
+  case AST_NODE_VARIABLE_DECLARATION:
+    return this->emit_variable_declaration(node);
+  case AST_NODE_VARIABLE_ASSIGNMENT:
+    return this->emit_variable_assignment(node);
+  case AST_NODE_BLOCK:
+    return this->emit_block(node);
+  case AST_FUNCTION_DEFINITION:
+    return this->emit_function_definition(node);
+  case AST_FUNCTION_CALL:
+    return this->emit_function_call(node);
+  case AST_BINARY_OPERATION:
+    return this->emit_binary_operation(index);
+  case AST_CONDITIONAL:
+    return this->emit_conditional(node);
+  case AST_LOOP:
+    return this->emit_loop(node);
+  default:
+    return nullptr;
+  }
+}
+
+/* Variables */
+
+llvm::Value *Codegen::emit_variable_declaration(const FlatNode &node) {
+  const FlatNode &value = this->ast.node(node.b);
+  llvm::Value *val = this->emit(node.b);
+  llvm::StringRef name = this->ast.text(node.a);
+
+  /*
+    Variable assignment is done by value, not reference. A freshly built array
+    or struct is bound to the new name directly, any other aggregate is copied
+    into storage of its own. Constant array literals are read-only globals,
+    they are only copied when the variable is written to.
+  */
+  if (this->ast.type_of(value).is_aggregate()) {
+    llvm::Type *storage_type = this->lower_type(value.type);
+    bool is_constant = value.node_type() == AST_NODE_BLOCK &&
+                       value.has(FLAT_CONSTANT);
+
+    if (!this->is_fresh_aggregate(node.b) ||
+        (is_constant && node.has(FLAT_MUTATED))) {
+      llvm::AllocaInst *copy = this->create_scoped_alloca(storage_type, name);
+      this->copy_aggregate(copy, val, storage_type);
+      val = copy;
+    }
+
+    this->symbols.define(node.a) = VariableDefinition(val, storage_type);
+    return val;
+  }
+
+  llvm::AllocaInst *alloca = this->create_scoped_alloca(val->getType(), name);
+  this->symbols.define(node.a) = VariableDefinition(alloca, val->getType());
+  return this->builder.CreateStore(val, alloca);
+}
+
+llvm::Value *Codegen::emit_variable_reference(const FlatNode &node) {
+  const VariableDefinition *var_def = this->symbols.lookup(node.a);
+
+  if (var_def == nullptr) {
+    std::cout << "Variable `" << this->ast.text(node.a)
+              << "` not found in symbols table!\n";
+    throw CompileError();
+  }
+
+  // Aggregates are used through a pointer to their storage.
+  if (this->ast.type_of(node).is_aggregate())
+    return var_def->v_value;
+
+  return this->builder.CreateLoad(var_def->v_type, var_def->v_value,
+                                  this->ast.text(node.a));
+}
+
+llvm::Value *Codegen::emit_variable_assignment(const FlatNode &node) {
+  const VariableDefinition *var_def = this->symbols.lookup(node.a);
+
+  if (var_def == nullptr) {
+    printf("Error! Cannot assign to variable `%s` that was not previously "
+           "defined.",
+           std::string(this->ast.text(node.a)).c_str());
+    throw CompileError();
+  }
+
+  // Lowering the value can define new symbols and move var_def.
+  VariableDefinition target = *var_def;
+  llvm::Value *val = this->emit(node.b);
+
+  if (this->ast.type_of(this->ast.node(node.b)).is_aggregate()) {
+    this->copy_aggregate(target.v_value, val, target.v_type);
+    return target.v_value;
+  }
+
+  return this->builder.CreateStore(val, target.v_value);
+}
+
+/* Blocks */
+
+llvm::Value *Codegen::emit_block(const FlatNode &node) {
+  std::span<const NodeIndex> children = this->ast.list(node.a, node.b);
+
+  if (node.has(FLAT_CONSTANT)) {
+    std::vector<uint32_t> elements(children.size());
+    for (size_t i = 0; i < children.size(); ++i)
+      elements[i] = this->ast.node(children[i]).a;
+
+    // Emitted as data rather than one store per element, so the size of the
+    // literal does not affect the size of the function.
+    llvm::GlobalVariable *array = new llvm::GlobalVariable(
+        this->module, this->lower_type(node.type), true,
+        llvm::GlobalValue::PrivateLinkage,
+        llvm::ConstantDataArray::get(this->context, elements), "array");
+    array->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+
+    return array;
+  }
+
+  if (node.has(FLAT_ARRAY)) {
+    llvm::Type *array_type = this->lower_type(node.type);
+
+    // Arrays can be bound to a name without being copied, so they get no
+    // lifetime markers and live until the function returns.
+    llvm::Value *array = this->create_entry_block_alloca(array_type, "array");
+
+    for (size_t i = 0; i < children.size(); ++i) {
+      llvm::Value *ptr_to_element_at_i = this->builder.CreateGEP(
+          array_type, array,
+          {this->builder.getInt32(0), this->builder.getInt32(i)});
+
+      this->builder.CreateStore(this->emit(children[i]), ptr_to_element_at_i);
+    }
+
+    return array;
+  }
+
+  if (node.has(FLAT_STRUCT))
+    return this->emit_struct_definition(node);
+
+  llvm::Value *last = nullptr;
+
+  for (NodeIndex child : children)
+    last = this->emit(child);
+
+  return last;
+}
+
+llvm::Value *Codegen::emit_struct_definition(const FlatNode &node) {
+  std::vector<llvm::Type *> structFields;
+
+  TypeDefinition s_def;
+
+  int i = 0;
+  for (NodeIndex index : this->ast.list(node.a, node.b)) {
+    const FlatNode &field = this->ast.node(index);
+    s_def.field_map.insert(field.a) = i++;
+    structFields.push_back(this->lower_type(field.type));
+  }
+
+  llvm::StructType *structType = llvm::StructType::create(
+      this->context, structFields, this->ast.text(node.c));
+
+  s_def.s_type = structType;
+  this->symbols.define_type(node.c) = std::move(s_def);
+
+  return nullptr;
+}
+
+/* Literals */
+
+// Identical literals share a single global across the whole module.
+llvm::Constant *Codegen::string_constant(std::string_view text) {
+  llvm::Constant *&literal = this->symbols.string_literal(text);
+
+  if (literal == nullptr)
+    literal = this->builder.CreateGlobalStringPtr(text, "", 0, &this->module);
+
+  return literal;
+}
+
+llvm::Value *Codegen::emit_string_literal(const FlatNode &node) {
+  return this->string_constant(this->ast.literal(node));
+}
+
+/* Functions */
+
+llvm::Function *Codegen::declare_function(Symbol name) {
+  llvm::StringRef func_name = this->ast.text(name);
+  if (llvm::Function *func = this->module.getFunction(func_name))
+    return func;
+
+  const NodeIndex *index = this->signatures.function_nodes.find(name);
+  if (index == nullptr) {
+    std::cout << "Error! Function `" << func_name.str() << "` not found!\n";
+    throw CompileError();
+  }
+
+  const FlatNode &node = this->ast.node(*index);
+  std::span<const NodeIndex> items = this->ast.list(node.b, node.c);
+
+  std::vector<llvm::Type *> func_arg_types;
+  for (NodeIndex arg : items.first(items.size() - 1))
+    func_arg_types.push_back(
+        this->lower_value_type(this->ast.node(arg).type));
+
+  llvm::Type *result_type = this->lower_value_type(node.type);
+
+  llvm ::FunctionType *funcType =
+      llvm::FunctionType::get(result_type, func_arg_types, false);
+
+  return llvm::Function::Create(funcType, llvm::Function::ExternalLinkage,
+                                func_name, this->module);
+}
+
+llvm::Value *Codegen::emit_function_definition(const FlatNode &node) {
+  std::span<const NodeIndex> items = this->ast.list(node.b, node.c);
+  std::span<const NodeIndex> args = items.first(items.size() - 1);
+
+  // Arguments are only visible inside the function body.
+  this->symbols.push_scope();
+
+  llvm::Function *func = this->declare_function(node.a);
+
+  llvm::BasicBlock *func_block =
+      llvm::BasicBlock::Create(this->context, "entry", func);
+  this->builder.SetInsertPoint(func_block);
+
+  /*
+    Scalar arguments are spilled to a stack slot so they can be assigned to
+    like any other local, mem2reg turns them back into registers. Arrays and
+    structs are passed by pointer and bound directly.
+  */
+  for (size_t i = 0; i < args.size(); ++i) {
+    const FlatNode &arg = this->ast.node(args[i]);
+    llvm::StringRef arg_name = this->ast.text(arg.a);
+    llvm::Argument *value = func->getArg(i);
+    value->setName(arg_name);
+
+    llvm::Type *arg_type = this->lower_type(arg.type);
+
+    if (this->ast.type_of(arg).is_aggregate()) {
+      this->symbols.define(arg.a) = VariableDefinition(value, arg_type);
+      continue;
+    }
+
+    llvm::AllocaInst *slot =
+        this->create_entry_block_alloca(arg_type, arg_name);
+    this->builder.CreateStore(value, slot);
+    this->symbols.define(arg.a) = VariableDefinition(slot, arg_type);
+  }
+
+  const FlatNode &body = this->ast.node(items.back());
+  for (NodeIndex body_node : this->ast.list(body.a, body.b))
+    this->emit(body_node);
+
+  if (this->builder.GetInsertBlock()->getTerminator() == nullptr) {
+    if (this->ast.type_of(node).type_kind() == ORC_TYPE_VOID)
+      this->builder.CreateRetVoid();
+    else
+      this->builder.CreateUnreachable();
+  }
+
+  this->builder.ClearInsertionPoint();
+  this->symbols.pop_scope();
+
+  return func;
+}
+
+llvm::Value *Codegen::emit_function_call(const FlatNode &node) {
+  std::span<const NodeIndex> args = this->ast.list(node.b, node.c);
+
+  /*
+    Struct initialization
+  */
+  if (TypeDefinition *s_def = this->symbols.lookup_type(node.a)) {
+    llvm::StructType *s_type = s_def->s_type;
+
+    llvm::Value *s_instance = this->create_scoped_alloca(
+        s_type, std::string(this->ast.text(node.a)) + "_struct");
+
+    for (unsigned i = 0; i < s_type->getNumElements(); ++i) {
+      llvm::Value *ptr = this->builder.CreateStructGEP(s_type, s_instance, i);
+      this->builder.CreateStore(this->emit(args[i]), ptr);
+    }
+
+    return s_instance;
+  }
+
+  /*
+    Return statements
+  */
+  if (node.a == SYM_RETURN) {
+    if (args.empty())
+      return this->builder.CreateRetVoid();
+
+    return this->builder.CreateRet(this->emit(args[0]));
+  }
+
+  if (node.a == SYM_PRINTF)
+    return this->emit_printf(node);
+
+  llvm::Function *func = this->declare_function(node.a);
+
+  std::vector<llvm::Value *> funcArgs;
+  for (NodeIndex arg : args)
+    funcArgs.push_back(this->emit(arg));
+
+  return this->builder.CreateCall(func, funcArgs);
+}
+
+/*
+  Lowers a printf call. When the format string is a literal it is parsed
+  here and the call becomes a sequence of writes into the output runtime
+  (runtime.h). Other calls go to printf itself, after flushing the runtime's
+  buffer so output stays in order.
+*/
+llvm::Value *Codegen::emit_printf(const FlatNode &node) {
+  std::span<const NodeIndex> args = this->ast.list(node.b, node.c);
+  const FlatNode &format = this->ast.node(args[0]);
+
+  std::vector<FormatPiece> pieces;
+  bool is_specialized = format.node_type() == AST_NODE_STRING_LITERAL &&
+                        parse_format(this->ast.literal(format), pieces);
+
+  size_t arg_index = 1;
+  for (size_t i = 0; is_specialized && i < pieces.size(); ++i) {
+    if (pieces[i].spec == 0)
+      continue;
+
+    is_specialized =
+        arg_index < args.size() &&
+        format_accepts(pieces[i].spec,
+                       this->ast.type_of(this->ast.node(args[arg_index])));
+    ++arg_index;
+  }
+  is_specialized = is_specialized && arg_index == args.size();
+
+  std::vector<llvm::Value *> values;
+  for (size_t i = is_specialized ? 1 : 0; i < args.size(); ++i) {
+    llvm::Value *value = this->emit(args[i]);
+
+    // Variadic arguments go through C's default promotions.
+    if (value->getType()->isIntegerTy(1))
+      value = this->builder.CreateZExt(value, this->builder.getInt32Ty());
+
+    values.push_back(value);
+  }
+
+  if (!is_specialized) {
+    llvm::FunctionType *flush_type =
+        llvm::FunctionType::get(this->builder.getVoidTy(), false);
+    this->builder.CreateCall(
+        this->module.getOrInsertFunction("orc_flush", flush_type));
+    return this->builder.CreateCall(this->module.getFunction("printf"),
+                                    values);
+  }
+
+  llvm::Value *written = nullptr;
+  llvm::Value **value = values.data();
+  llvm::Type *i32 = this->builder.getInt32Ty();
+  llvm::Type *i8_ptr = this->builder.getInt8PtrTy();
+
+  for (FormatPiece &piece : pieces) {
+    llvm::Value *result;
+
+    if (piece.spec == 's') {
+      result = this->builder.CreateCall(
+          runtime_function(this->module, this->builder, "orc_write_string",
+                           {i8_ptr}),
+          {*value++});
+    } else if (piece.spec == 'c') {
+      result = this->builder.CreateCall(
+          runtime_function(this->module, this->builder, "orc_write_char",
+                           {i32}),
+          {*value++});
+    } else if (piece.spec != 0) {
+      result = this->builder.CreateCall(
+          runtime_function(this->module, this->builder, "orc_write_int",
+                           {i32}),
+          {*value++});
+    } else if (piece.text.size() == 1) {
+      result = this->builder.CreateCall(
+          runtime_function(this->module, this->builder, "orc_write_char",
+                           {i32}),
+          {this->builder.getInt32((unsigned char)piece.text[0])});
+    } else {
+      result = this->builder.CreateCall(
+          runtime_function(this->module, this->builder, "orc_write",
+                           {i8_ptr, i32}),
+          {this->string_constant(piece.text),
+           this->builder.getInt32(piece.text.size())});
+    }
+
+    written = written ? this->builder.CreateAdd(written, result) : result;
+  }
+
+  return written ? written : this->builder.getInt32(0);
+}
+
+/* Operators */
+
+// Address of an assignable expression: a variable, an array element or a
+// struct field.
+llvm::Value *Codegen::emit_address(NodeIndex index) {
+  const FlatNode &node = this->ast.node(index);
+
+  if (node.node_type() == AST_NODE_VARIABLE_REFERENCE) {
+    const VariableDefinition *var_def = this->symbols.lookup(node.a);
+
+    if (var_def == nullptr) {
+      printf("Error! Cannot assign to variable `%s` that was not previously "
+             "defined.\n",
+             std::string(this->ast.text(node.a)).c_str());
+      throw CompileError();
+    }
+
+    return var_def->v_value;
+  }
+
+  const FlatNode &left = this->ast.node(node.a);
+  llvm::Value *base = this->emit(node.a);
+
+  if (node.binary_op() == BINARY_OP_ACCESSOR) {
+    TypeDefinition *s_def =
+        this->symbols.lookup_type(this->ast.type_of(left).name);
+    Symbol field = this->ast.node(node.b).a;
+
+    return this->builder.CreateStructGEP(
+        s_def->s_type, base, *s_def->field_map.find(field), "fieldPtr");
+  }
+
+  llvm::Value *element = this->emit(node.b);
+
+  return this->builder.CreateInBoundsGEP(
+      this->lower_type(left.type), base, {this->builder.getInt32(0), element},
+      "elementPtr");
+}
+
+llvm::Value *Codegen::emit_binary_operation(NodeIndex index) {
+  const FlatNode &node = this->ast.node(index);
+
+  switch (node.binary_op()) {
+  case BINARY_OP_ACCESSOR:
+  case BINARY_OP_INDEX: {
+    llvm::Value *ptr = this->emit_address(index);
+
+    if (this->ast.type_of(node).is_aggregate())
+      return ptr;
+
+    return this->builder.CreateLoad(this->lower_type(node.type), ptr);
+  }
+
+  case BINARY_OP_ASSIGN: {
+    const FlatNode &right = this->ast.node(node.b);
+    llvm::Value *ptr = this->emit_address(node.a);
+    llvm::Value *rhs = this->emit(node.b);
+
+    if (this->ast.type_of(right).is_aggregate()) {
+      this->copy_aggregate(ptr, rhs, this->lower_type(right.type));
+      return ptr;
+    }
+
+    return this->builder.CreateStore(rhs, ptr);
+  }
+
+  default:
+    break;
+  }
+
+  /*
+    A chain such as `a + b + ... + z` is lowered iteratively along its left
+    operands, innermost first, so its length does not cost native stack.
+  */
+  llvm::SmallVector<const FlatNode *, 16> spine{&node};
+  while (true) {
+    const FlatNode &left = this->ast.node(spine.back()->a);
+    if (left.node_type() != AST_BINARY_OPERATION ||
+        !is_value_operator(left.binary_op()))
+      break;
+    spine.push_back(&left);
+  }
+
+  llvm::Value *value = this->emit(spine.back()->a);
+
+  for (size_t i = spine.size(); i-- > 0;) {
+    llvm::Value *rhs = this->emit(spine[i]->b);
+    value = emit_value_operator(spine[i]->binary_op(), this->builder, value,
+                                rhs);
+  }
+
+  return value;
+}
+
+/* Control flow */
+
+// Conditions are bools, ints are compared against zero.
+llvm::Value *Codegen::emit_condition(NodeIndex index) {
+  llvm::Value *value = this->emit(index);
+
+  if (this->ast.type_of(this->ast.node(index)).type_kind() == ORC_TYPE_INT)
+    return this->builder.CreateICmpNE(value, this->builder.getInt32(0));
+
+  return value;
+}
+
+void Codegen::emit_scoped_block(NodeIndex index) {
+  this->symbols.push_scope();
+  this->emit(index);
+  this->end_scope();
+}
+
+llvm::Value *Codegen::emit_conditional(const FlatNode &node) {
+  llvm::Value *Cond = this->emit_condition(node.a);
+
+  llvm::Function *TheFunction = this->builder.GetInsertBlock()->getParent();
+
+  llvm::BasicBlock *OnTrueBB =
+      llvm::BasicBlock::Create(this->context, "then", TheFunction);
+  llvm::BasicBlock *OnFalseBB = llvm::BasicBlock::Create(this->context, "else");
+  llvm::BasicBlock *MergeBB = llvm::BasicBlock::Create(this->context, "ifcont");
+
+  this->builder.CreateCondBr(Cond, OnTrueBB, OnFalseBB);
+  this->builder.SetInsertPoint(OnTrueBB);
+  this->emit_scoped_block(node.b);
+
+  bool onTrueHasReturn = this->does_block_end_in_return(node.b);
+  bool onFalseHasReturn = this->does_block_end_in_return(node.c);
+
+  // If the block has a return statement in it, dont create the branch.
+  if (!onTrueHasReturn)
+    this->builder.CreateBr(MergeBB);
+
+  OnTrueBB = this->builder.GetInsertBlock();
+
+  TheFunction->getBasicBlockList().push_back(OnFalseBB);
+  this->builder.SetInsertPoint(OnFalseBB);
+  this->emit_scoped_block(node.c);
+
+  // If the block has a return statement in it, dont create the branch.
+  if (!onFalseHasReturn)
+    this->builder.CreateBr(MergeBB);
+
+  OnFalseBB = this->builder.GetInsertBlock();
+
+  if (!(onTrueHasReturn && onFalseHasReturn)) {
+    TheFunction->getBasicBlockList().push_back(MergeBB);
+  }
+
+  this->builder.SetInsertPoint(MergeBB);
+
+  return nullptr;
+}
+
+llvm::Value *Codegen::emit_loop(const FlatNode &node) {
+  llvm::Function *TheFunction = this->builder.GetInsertBlock()->getParent();
+
+  llvm::BasicBlock *CondBB =
+      llvm::BasicBlock::Create(this->context, "whilecond", TheFunction);
+  llvm::BasicBlock *LoopBB =
+      llvm::BasicBlock::Create(this->context, "loopbody", TheFunction);
+  llvm::BasicBlock *EndBB = llvm::BasicBlock::Create(this->context, "loopend");
+
+  this->builder.CreateBr(CondBB);
+  this->builder.SetInsertPoint(CondBB);
+
+  llvm::Value *Cond = this->emit_condition(node.a);
+
+  this->builder.CreateCondBr(Cond, LoopBB, EndBB);
+
+  this->builder.SetInsertPoint(LoopBB);
+  this->emit_scoped_block(node.b);
+  this->builder.CreateBr(CondBB);
+
+  TheFunction->getBasicBlockList().push_back(EndBB);
+  this->builder.SetInsertPoint(EndBB);
+
+  return nullptr;
+}
+
+/* Helpers */
+
+// Array literals and struct initializers build a new aggregate that nothing
+// else refers to yet.
+bool Codegen::is_fresh_aggregate(NodeIndex index) {
+  const FlatNode &node = this->ast.node(index);
+
+  if (node.node_type() == AST_NODE_BLOCK)
+    return node.has(FLAT_ARRAY);
+
+  return node.node_type() == AST_FUNCTION_CALL &&
+         this->symbols.lookup_type(node.a) != nullptr;
+}
+
+bool Codegen::does_block_end_in_return(NodeIndex index) {
+  const FlatNode &block = this->ast.node(index);
+
+  if (block.b == 0)
+    return false;
+
+  const FlatNode &last =
+      this->ast.node(this->ast.list(block.a, block.b).back());
+
+  return last.node_type() == AST_FUNCTION_CALL && last.a == SYM_RETURN;
+}
+
+void Codegen::copy_aggregate(llvm::Value *dest, llvm::Value *src,
+                             llvm::Type *type) {
+  const llvm::DataLayout &layout = this->module.getDataLayout();
+  this->builder.CreateMemCpy(dest, layout.getPrefTypeAlign(type), src,
+                             layout.getPrefTypeAlign(type),
+                             layout.getTypeAllocSize(type));
+}
+
+/*
+  Every stack slot is allocated in the entry block, so a local declared in a
+  loop body reuses one slot instead of growing the stack on each iteration,
+  and mem2reg/SROA can promote it.
+*/
+llvm::AllocaInst *Codegen::create_entry_block_alloca(llvm::Type *type,
+                                                     llvm::StringRef name) {
+  llvm::BasicBlock &entry =
+      this->builder.GetInsertBlock()->getParent()->getEntryBlock();
+  llvm::IRBuilder<> entry_builder(&entry, entry.begin());
+  return entry_builder.CreateAlloca(type, nullptr, name);
+}
+
+// Entry block alloca whose lifetime starts here and ends with the innermost
+// scope.
+llvm::AllocaInst *Codegen::create_scoped_alloca(llvm::Type *type,
+                                                llvm::StringRef name) {
+  llvm::AllocaInst *alloca = this->create_entry_block_alloca(type, name);
+  this->builder.CreateLifetimeStart(alloca);
+  this->symbols.add_lifetime(alloca);
+  return alloca;
+}
+
+// Ends the lifetime of the innermost scope's locals and pops it. Blocks that
+// already returned need no markers.
+void Codegen::end_scope() {
+  if (this->builder.GetInsertBlock()->getTerminator() == nullptr) {
+    for (llvm::AllocaInst *alloca : this->symbols.lifetimes())
+      this->builder.CreateLifetimeEnd(alloca);
+  }
+
+  this->symbols.pop_scope();
+}
+
+/*
+  Lowering of semantic types. Scalars map to their LLVM type, arrays and
+  structs to the type of their storage.
+*/
+llvm::Type *Codegen::lower_type(TypeIndex index) {
+  const FlatType &type = this->ast.type(index);
+
+  switch (type.type_kind()) {
+  case ORC_TYPE_VOID:
+    return llvm::Type::getVoidTy(this->context);
+  case ORC_TYPE_INT:
+    return llvm::Type::getInt32Ty(this->context);
+  case ORC_TYPE_BOOL:
+    return llvm::Type::getInt1Ty(this->context);
+  case ORC_TYPE_FLOAT:
+    return llvm::Type::getFloatTy(this->context);
+  case ORC_TYPE_STRING:
+    return llvm::Type::getInt8PtrTy(this->context);
+  case ORC_TYPE_ARRAY:
+    return llvm::ArrayType::get(this->lower_type(type.element), type.length);
+  case ORC_TYPE_STRUCT:
+    return this->symbols.lookup_type(type.name)->s_type;
+  }
+
+  return nullptr;
+}
+
+// The type of a value of `type` once loaded, aggregates are handled through
+// a pointer to their storage.
+llvm::Type *Codegen::lower_value_type(TypeIndex index) {
+  llvm::Type *lowered = this->lower_type(index);
+  return this->ast.type(index).is_aggregate() ? lowered->getPointerTo()
+                                              : lowered;
+}
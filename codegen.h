@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+
+#include "flat_ast.h"
+#include "symbol_map.h"
+#include "symbol_table.h"
+
+/*
+  The declarations of a program, by node: every struct definition and every
+  function definition in source order, and the functions by name. Built
+  once before codegen and only read while it runs, so any number of
+  Codegen instances can share it.
+*/
+struct ProgramSignatures {
+  static ProgramSignatures build(const FlatAST &ast);
+
+  std::vector<NodeIndex> structs;
+  std::vector<NodeIndex> functions;
+  SymbolMap<NodeIndex> function_nodes;
+};
+
+/*
+  Lowers a FlatAST to LLVM IR. Every node kind has its own emit function,
+  dispatched from a single switch in emit(). Types come from Sema, so every
+  node is lowered exactly once. Errors are a message and a CompileError,
+  like everywhere else in the compiler.
+
+  A Codegen fills a single module with a subset of the program's functions.
+  Functions defined elsewhere are declared from the shared signatures when
+  first called and resolved when the modules are linked, which lets the
+  functions of one program be generated by several threads, each with a
+  module and context of its own.
+*/
+class Codegen {
+public:
+  Codegen(const FlatAST &ast, const ProgramSignatures &signatures,
+          llvm::LLVMContext &context, llvm::Module &module,
+          llvm::IRBuilder<> &builder, SymbolTable &symbols)
+      : ast(ast), signatures(signatures), context(context), module(module),
+        builder(builder), symbols(symbols) {}
+
+  // Defines every struct of the program, then emits `functions`.
+  void emit_unit(std::span<const NodeIndex> functions);
+  llvm::Value *emit(NodeIndex index);
+
+private:
+  const FlatAST &ast;
+  const ProgramSignatures &signatures;
+  llvm::LLVMContext &context;
+  llvm::Module &module;
+  llvm::IRBuilder<> &builder;
+  SymbolTable &symbols;
+
+  llvm::Value *emit_variable_declaration(const FlatNode &node);
+  llvm::Value *emit_variable_reference(const FlatNode &node);
+  llvm::Value *emit_variable_assignment(const FlatNode &node);
+  llvm::Value *emit_block(const FlatNode &node);
+  llvm::Value *emit_struct_definition(const FlatNode &node);
+  llvm::Value *emit_string_literal(const FlatNode &node);
+  llvm::Value *emit_function_definition(const FlatNode &node);
+  // Declares function `name` in this module unless it already is.
+  llvm::Function *declare_function(Symbol name);
+  llvm::Value *emit_function_call(const FlatNode &node);
+  llvm::Value *emit_printf(const FlatNode &node);
+  llvm::Value *emit_binary_operation(NodeIndex index);
+  llvm::Value *emit_conditional(const FlatNode &node);
+  llvm::Value *emit_loop(const FlatNode &node);
+
+  llvm::Value *emit_address(NodeIndex index);
+  llvm::Value *emit_condition(NodeIndex index);
+  // Body of a conditional or loop, in a scope of its own.
+  void emit_scoped_block(NodeIndex index);
+  llvm::Constant *string_constant(std::string_view text);
+
+  bool is_fresh_aggregate(NodeIndex index);
+  bool does_block_end_in_return(NodeIndex index);
+
+  void copy_aggregate(llvm::Value *dest, llvm::Value *src, llvm::Type *type);
+  llvm::AllocaInst *create_entry_block_alloca(llvm::Type *type,
+                                              llvm::StringRef name);
+  llvm::AllocaInst *create_scoped_alloca(llvm::Type *type,
+                                         llvm::StringRef name);
+  void end_scope();
+
+  llvm::Type *lower_type(TypeIndex type);
+  llvm::Type *lower_value_type(TypeIndex type);
+};
@@ -0,0 +1,10 @@
+#pragma once
+
+/*
+  Thrown once an error has been printed, where the compiler used to call
+  exit(1). Files and units are compiled on worker threads, and exiting from
+  one would run the static destructors under the others and leave their
+  temporary files behind. The error unwinds to the driver instead, which
+  exits with status 1 once every worker is done and its files are removed.
+*/
+struct CompileError {};
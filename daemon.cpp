@@ -0,0 +1,418 @@
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "daemon.h"
+#include "orc_llvm.h"
+
+// Latencies kept for the percentiles in the stats report.
+static constexpr size_t LATENCY_SAMPLES = 1024;
+// Connections waiting for accept(), on top of the daemon's own queue.
+static constexpr int LISTEN_BACKLOG = 128;
+// A client that has not sent its whole request by then is dropped.
+static constexpr std::chrono::seconds REQUEST_TIMEOUT{5};
+// Largest request accepted, working directory and arguments included.
+static constexpr uint32_t MAX_REQUEST_SIZE = 1 << 20;
+
+/*
+  Signals are turned into bytes on this pipe, so the serve loop can wait
+  for them in the same poll() as for new connections: 'c' when a child
+  exits, 'q' when the daemon should stop.
+*/
+static int signal_pipe[2] = {-1, -1};
+
+static void on_signal(int signal_number) {
+  int saved_errno = errno;
+  char byte = signal_number == SIGCHLD ? 'c' : 'q';
+  (void)!write(signal_pipe[1], &byte, 1);
+  errno = saved_errno;
+}
+
+static void set_signal_handler(int signal_number, void (*handler)(int)) {
+  struct sigaction action {};
+  action.sa_handler = handler;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART | (signal_number == SIGCHLD ? SA_NOCLDSTOP : 0);
+  sigaction(signal_number, &action, nullptr);
+}
+
+int CompilerDaemon::serve() {
+  // Children start with everything the daemon did before forking them.
+  OrcLLVM::register_targets();
+
+  if (pipe2(signal_pipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+    std::cout << "Error! Could not create the signal pipe: "
+              << std::strerror(errno) << "\n";
+    return 1;
+  }
+  set_signal_handler(SIGCHLD, on_signal);
+  set_signal_handler(SIGINT, on_signal);
+  set_signal_handler(SIGTERM, on_signal);
+  signal(SIGPIPE, SIG_IGN);
+
+  if (!this->listen_on_socket())
+    return 1;
+
+  printf("orc daemon listening on `%s` (%u jobs)\n", this->socket_path.c_str(),
+         this->jobs);
+  fflush(stdout);
+
+  /*
+    Requests are read as their bytes arrive, from the same poll() that
+    waits for signals and new connections, so a slow client only holds up
+    itself. Once stopping, only the requests already read are finished.
+  */
+  bool stopping = false;
+  std::vector<pollfd> fds;
+  while (!stopping || !this->queue.empty() || !this->running.empty()) {
+    fds.assign({{signal_pipe[0], POLLIN, 0}});
+    if (!stopping) {
+      fds.push_back({this->listen_fd, POLLIN, 0});
+      for (const Request &request : this->reading)
+        fds.push_back({request.connection, POLLIN, 0});
+    }
+
+    if (poll(fds.data(), fds.size(), this->poll_timeout_ms()) < 0 &&
+        errno != EINTR) {
+      std::cout << "Error! poll failed: " << std::strerror(errno) << "\n";
+      return 1;
+    }
+
+    char bytes[64];
+    ssize_t count;
+    while ((count = read(signal_pipe[0], bytes, sizeof(bytes))) > 0) {
+      if (std::find(bytes, bytes + count, 'q') != bytes + count &&
+          !stopping) {
+        stopping = true;
+        close(this->listen_fd);
+        unlink(this->socket_path.c_str());
+        while (!this->reading.empty())
+          this->drop_reading(this->reading.size() - 1);
+      }
+    }
+
+    if (!stopping) {
+      // Backwards, since a request that is complete leaves `reading`.
+      for (size_t i = this->reading.size(); i-- > 0;) {
+        if (fds[2 + i].revents != 0)
+          this->read_request(i);
+      }
+      if (fds[1].revents & POLLIN)
+        this->accept_connections();
+      this->drop_stale_connections();
+    }
+
+    this->reap_children();
+    this->start_requests();
+  }
+
+  printf("%s", this->stats_report().c_str());
+  return 0;
+}
+
+bool CompilerDaemon::listen_on_socket() {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (this->socket_path.size() >= sizeof(address.sun_path)) {
+    std::cout << "Error! Socket path `" << this->socket_path
+              << "` is too long.\n";
+    return false;
+  }
+  std::memcpy(address.sun_path, this->socket_path.c_str(),
+              this->socket_path.size() + 1);
+
+  // A socket left behind by a daemon that did not shut down cleanly is
+  // replaced, one that still has a daemon behind it is not.
+  int existing = daemon_connect(this->socket_path);
+  if (existing >= 0) {
+    close(existing);
+    std::cout << "Error! A daemon is already listening on `"
+              << this->socket_path << "`\n";
+    return false;
+  }
+  struct stat socket_stat;
+  if (lstat(this->socket_path.c_str(), &socket_stat) == 0 &&
+      S_ISSOCK(socket_stat.st_mode))
+    unlink(this->socket_path.c_str());
+
+  this->listen_fd =
+      socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  if (this->listen_fd < 0 ||
+      bind(this->listen_fd, (sockaddr *)&address, sizeof(address)) != 0 ||
+      listen(this->listen_fd, LISTEN_BACKLOG) != 0) {
+    std::cout << "Error! Could not listen on `" << this->socket_path
+              << "`: " << std::strerror(errno) << "\n";
+    return false;
+  }
+
+  return true;
+}
+
+// Takes every connection that is waiting, their requests are read later.
+void CompilerDaemon::accept_connections() {
+  while (true) {
+    Request request;
+    request.connection = accept4(this->listen_fd, nullptr, nullptr,
+                                 SOCK_CLOEXEC | SOCK_NONBLOCK);
+    if (request.connection < 0)
+      return;
+
+    request.accepted = Clock::now();
+    this->reading.push_back(std::move(request));
+  }
+}
+
+/*
+  Reads what has arrived of a request without blocking. The header comes
+  in a single message with the client's descriptors, the strings after it
+  may take several reads. A complete request is dispatched, a malformed
+  one or a client that hung up is dropped.
+*/
+void CompilerDaemon::read_request(size_t index) {
+  Request &request = this->reading[index];
+
+  if (!request.has_header) {
+    int fds[DAEMON_FD_COUNT];
+    if (!daemon_receive_request(request.connection, request.header, fds)) {
+      this->drop_reading(index);
+      return;
+    }
+    std::copy(fds, fds + DAEMON_FD_COUNT, request.fds);
+
+    if (request.header.size > MAX_REQUEST_SIZE) {
+      this->drop_reading(index);
+      return;
+    }
+    request.has_header = true;
+    request.payload.resize(request.header.size);
+  }
+
+  while (request.payload_read < request.payload.size()) {
+    ssize_t count = read(request.connection,
+                         request.payload.data() + request.payload_read,
+                         request.payload.size() - request.payload_read);
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      return;
+    if (count <= 0) {
+      this->drop_reading(index);
+      return;
+    }
+    request.payload_read += count;
+  }
+
+  if (!daemon_parse_strings(request.payload, request.strings) ||
+      request.strings.empty()) {
+    this->drop_reading(index);
+    return;
+  }
+
+  Request complete = std::move(request);
+  complete.payload = std::string();
+  this->reading.erase(this->reading.begin() + index);
+  this->dispatch(complete);
+}
+
+void CompilerDaemon::drop_reading(size_t index) {
+  this->close_request(this->reading[index]);
+  this->reading.erase(this->reading.begin() + index);
+}
+
+void CompilerDaemon::drop_stale_connections() {
+  Clock::time_point deadline = Clock::now() - REQUEST_TIMEOUT;
+  size_t stale = 0;
+  while (stale < this->reading.size() &&
+         this->reading[stale].accepted <= deadline)
+    this->close_request(this->reading[stale++]);
+  this->reading.erase(this->reading.begin(), this->reading.begin() + stale);
+}
+
+// Until the oldest connection being read times out, forever without one.
+int CompilerDaemon::poll_timeout_ms() const {
+  if (this->reading.empty())
+    return -1;
+
+  auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+      this->reading.front().accepted + REQUEST_TIMEOUT - Clock::now());
+  return std::max<int64_t>(remaining.count(), 0);
+}
+
+/*
+  Stats are answered right away, compiles are queued. Replies are a few
+  hundred bytes at most and fit in the socket's buffer, so writing them
+  to the non-blocking connection does not fail on a slow client.
+*/
+void CompilerDaemon::dispatch(Request &request) {
+  if (request.header.kind == DAEMON_STATS) {
+    std::string report = this->stats_report();
+    uint32_t size = report.size();
+    daemon_write_all(request.connection, &size, sizeof(size));
+    daemon_write_all(request.connection, report.data(), report.size());
+    this->close_request(request);
+    return;
+  }
+
+  this->queue.push_back(std::move(request));
+  this->max_queue_depth = std::max(this->max_queue_depth, this->queue.size());
+}
+
+void CompilerDaemon::start_requests() {
+  while (!this->queue.empty() && this->running.size() < this->jobs) {
+    Request request = std::move(this->queue.front());
+    this->queue.pop_front();
+
+    // Anything still buffered would be written again by the child.
+    fflush(stdout);
+
+    pid_t pid = fork();
+    if (pid == 0)
+      this->run_child(request);
+
+    if (pid < 0) {
+      this->finish(request, 1);
+      continue;
+    }
+
+    // The child has its own copies of the client's streams.
+    for (int &fd : request.fds) {
+      close(fd);
+      fd = -1;
+    }
+    this->running.emplace(pid, std::move(request));
+  }
+}
+
+void CompilerDaemon::run_child(Request &request) {
+  signal(SIGCHLD, SIG_DFL);
+  signal(SIGINT, SIG_DFL);
+  signal(SIGTERM, SIG_DFL);
+  signal(SIGPIPE, SIG_DFL);
+
+  // Only the daemon answers the client, and only this request is the
+  // child's business.
+  close(signal_pipe[0]);
+  close(signal_pipe[1]);
+  close(this->listen_fd);
+  for (Request &unread : this->reading)
+    this->close_request(unread);
+  for (Request &queued : this->queue)
+    this->close_request(queued);
+  for (auto &[pid, other] : this->running)
+    close(other.connection);
+  close(request.connection);
+
+  for (int i = 0; i < DAEMON_FD_COUNT; ++i) {
+    if (request.fds[i] != i) {
+      dup2(request.fds[i], i);
+      close(request.fds[i]);
+    }
+  }
+
+  if (chdir(request.strings[0].c_str()) != 0) {
+    printf("Error! Could not change to directory `%s`\n",
+           request.strings[0].c_str());
+    exit(1);
+  }
+
+  // The daemon's own arguments come first so that the client's win, but
+  // after `run`, which has to stay the first argument.
+  std::vector<std::string> args(request.strings.begin() + 1,
+                                request.strings.end());
+  size_t insert_at = !args.empty() && args[0] == "run" ? 1 : 0;
+  args.insert(args.begin() + insert_at, this->default_args.begin(),
+              this->default_args.end());
+
+  std::vector<char *> argv;
+  argv.push_back((char *)"orc");
+  for (std::string &arg : args)
+    argv.push_back(arg.data());
+  argv.push_back(nullptr);
+
+  exit(this->driver(argv.size() - 1, argv.data()));
+}
+
+void CompilerDaemon::reap_children() {
+  int status = 0;
+  pid_t pid;
+
+  while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+    auto it = this->running.find(pid);
+    if (it == this->running.end())
+      continue;
+
+    // Same exit code a shell reports for a child killed by a signal.
+    int exit_code = WIFEXITED(status) ? WEXITSTATUS(status)
+                                      : 128 + WTERMSIG(status);
+    this->finish(it->second, exit_code);
+    this->running.erase(it);
+  }
+}
+
+void CompilerDaemon::finish(Request &request, int exit_code) {
+  std::chrono::duration<double, std::milli> latency =
+      Clock::now() - request.accepted;
+
+  if (this->latencies_ms.size() < LATENCY_SAMPLES) {
+    this->latencies_ms.push_back(latency.count());
+  } else {
+    this->latencies_ms[this->next_latency] = latency.count();
+    this->next_latency = (this->next_latency + 1) % LATENCY_SAMPLES;
+  }
+
+  this->served += 1;
+  if (exit_code != 0)
+    this->failed += 1;
+
+  uint32_t reply = exit_code;
+  daemon_write_all(request.connection, &reply, sizeof(reply));
+  this->close_request(request);
+}
+
+void CompilerDaemon::close_request(Request &request) {
+  for (int &fd : request.fds) {
+    if (fd >= 0)
+      close(fd);
+    fd = -1;
+  }
+
+  close(request.connection);
+  request.connection = -1;
+}
+
+std::string CompilerDaemon::stats_report() const {
+  std::vector<double> sorted = this->latencies_ms;
+  std::sort(sorted.begin(), sorted.end());
+
+  auto percentile = [&](double fraction) {
+    if (sorted.empty())
+      return 0.0;
+    return sorted[(size_t)(fraction * (sorted.size() - 1))];
+  };
+  double total_ms = 0;
+  for (double latency : sorted)
+    total_ms += latency;
+
+  char report[512];
+  snprintf(report, sizeof(report),
+           "--- Daemon Stats ---\n"
+           "requests: %zu served, %zu failed\n"
+           "running: %zu of %u\n"
+           "queued: %zu (at most %zu)\n"
+           "latency (ms, last %zu): mean %.3f, p50 %.3f, p99 %.3f, max %.3f\n",
+           this->served, this->failed, this->running.size(), this->jobs,
+           this->queue.size(), this->max_queue_depth, sorted.size(),
+           sorted.empty() ? 0.0 : total_ms / sorted.size(), percentile(0.5),
+           percentile(0.99), sorted.empty() ? 0.0 : sorted.back());
+  return report;
+}
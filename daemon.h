@@ -0,0 +1,90 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "daemon_protocol.h"
+
+/*
+  `orc --daemon`: serves compile requests from orc_client over a Unix
+  socket. Every request is compiled in a child forked from the daemon, so
+  it starts with LLVM loaded and the native target registered, but with a
+  context and everything else of its own, and a compile error that exits
+  only ends that request. At most `jobs` requests are compiled at once, the
+  others wait in arrival order.
+
+  The daemon itself stays single-threaded, which is what makes forking it
+  safe.
+*/
+class CompilerDaemon {
+public:
+  // Runs the command line `argv` like `orc` would, returning its exit code.
+  using Driver = int (*)(int argc, char **argv);
+
+  CompilerDaemon(std::string socket_path, unsigned jobs,
+                 std::vector<std::string> default_args, Driver driver)
+      : socket_path(std::move(socket_path)), jobs(jobs),
+        default_args(std::move(default_args)), driver(driver) {}
+
+  // Serves requests until SIGINT or SIGTERM, then finishes the ones it has
+  // accepted and returns the exit code of the daemon.
+  int serve();
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Request {
+    int connection = -1;
+    int fds[DAEMON_FD_COUNT] = {-1, -1, -1};
+    // Working directory of the client, then its arguments.
+    std::vector<std::string> strings;
+    Clock::time_point accepted;
+
+    // While the request is read: the header once it has arrived, then the
+    // bytes of the strings as they come in.
+    bool has_header = false;
+    DaemonRequest header;
+    std::string payload;
+    size_t payload_read = 0;
+  };
+
+  std::string socket_path;
+  unsigned jobs;
+  // Arguments given to the daemon that apply to every request, such as the
+  // cache directory.
+  std::vector<std::string> default_args;
+  Driver driver;
+
+  int listen_fd = -1;
+  // Connections whose request has not fully arrived, oldest first.
+  std::vector<Request> reading;
+  std::deque<Request> queue;
+  std::map<pid_t, Request> running;
+
+  size_t served = 0;
+  size_t failed = 0;
+  size_t max_queue_depth = 0;
+  // Latency of the last requests, from accept to exit, in ms.
+  std::vector<double> latencies_ms;
+  size_t next_latency = 0;
+
+  bool listen_on_socket();
+  void accept_connections();
+  void read_request(size_t index);
+  void drop_reading(size_t index);
+  void drop_stale_connections();
+  int poll_timeout_ms() const;
+  void dispatch(Request &request);
+  void start_requests();
+  // Sets up the standard streams and working directory of a forked child
+  // and runs the driver, never returns.
+  [[noreturn]] void run_child(Request &request);
+  void reap_children();
+  void finish(Request &request, int status);
+  void close_request(Request &request);
+  std::string stats_report() const;
+};
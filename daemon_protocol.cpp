@@ -0,0 +1,142 @@
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "daemon_protocol.h"
+
+bool daemon_write_all(int fd, const void *data, size_t size) {
+  const char *bytes = (const char *)data;
+
+  while (size > 0) {
+    ssize_t count = send(fd, bytes, size, MSG_NOSIGNAL);
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count <= 0)
+      return false;
+    bytes += count;
+    size -= count;
+  }
+
+  return true;
+}
+
+bool daemon_read_all(int fd, void *data, size_t size) {
+  char *bytes = (char *)data;
+
+  while (size > 0) {
+    ssize_t count = read(fd, bytes, size);
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count <= 0)
+      return false;
+    bytes += count;
+    size -= count;
+  }
+
+  return true;
+}
+
+int daemon_connect(const std::string &path) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path))
+    return -1;
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return -1;
+
+  if (connect(fd, (sockaddr *)&address, sizeof(address)) != 0) {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+bool daemon_send_request(int fd, DaemonRequest request,
+                         const std::vector<std::string> &strings) {
+  std::string payload;
+  for (const std::string &string : strings)
+    payload.append(string.c_str(), string.size() + 1);
+  request.size = payload.size();
+
+  // The descriptors travel with the header, as SCM_RIGHTS.
+  int fds[DAEMON_FD_COUNT] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))] = {};
+
+  iovec header = {&request, sizeof(request)};
+  msghdr message{};
+  message.msg_iov = &header;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+
+  cmsghdr *rights = CMSG_FIRSTHDR(&message);
+  rights->cmsg_level = SOL_SOCKET;
+  rights->cmsg_type = SCM_RIGHTS;
+  rights->cmsg_len = CMSG_LEN(sizeof(fds));
+  std::memcpy(CMSG_DATA(rights), fds, sizeof(fds));
+
+  ssize_t sent;
+  do {
+    sent = sendmsg(fd, &message, MSG_NOSIGNAL);
+  } while (sent < 0 && errno == EINTR);
+
+  if (sent != (ssize_t)sizeof(request))
+    return false;
+  return daemon_write_all(fd, payload.data(), payload.size());
+}
+
+bool daemon_receive_request(int fd, DaemonRequest &request,
+                            int fds[DAEMON_FD_COUNT]) {
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * DAEMON_FD_COUNT)];
+
+  iovec header = {&request, sizeof(request)};
+  msghdr message{};
+  message.msg_iov = &header;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+
+  ssize_t received;
+  do {
+    received = recvmsg(fd, &message, MSG_CMSG_CLOEXEC);
+  } while (received < 0 && errno == EINTR);
+
+  cmsghdr *rights = CMSG_FIRSTHDR(&message);
+  bool has_fds = rights != nullptr && rights->cmsg_level == SOL_SOCKET &&
+                 rights->cmsg_type == SCM_RIGHTS &&
+                 rights->cmsg_len == CMSG_LEN(sizeof(int) * DAEMON_FD_COUNT);
+  if (has_fds)
+    std::memcpy(fds, CMSG_DATA(rights), sizeof(int) * DAEMON_FD_COUNT);
+
+  bool ok = received == (ssize_t)sizeof(request) && has_fds &&
+            (message.msg_flags & MSG_CTRUNC) == 0 &&
+            request.magic == DAEMON_MAGIC &&
+            request.version == DAEMON_VERSION;
+
+  if (!ok && has_fds) {
+    for (int i = 0; i < DAEMON_FD_COUNT; ++i)
+      close(fds[i]);
+  }
+
+  return ok;
+}
+
+bool daemon_parse_strings(const std::string &payload,
+                          std::vector<std::string> &strings) {
+  size_t begin = 0;
+  while (begin < payload.size()) {
+    size_t end = payload.find('\0', begin);
+    if (end == std::string::npos)
+      return false;
+    strings.push_back(payload.substr(begin, end - begin));
+    begin = end + 1;
+  }
+
+  return true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+  What `orc --daemon` and orc_client say to each other over a Unix stream
+  socket. The client sends a DaemonRequest along with its stdin, stdout and
+  stderr, then `size` bytes of NUL-terminated strings: its working
+  directory followed by its arguments. The compiler writes straight to the
+  descriptors it was handed, so the socket only carries the reply: the exit
+  status of a DAEMON_COMPILE request, or the length and text of the report
+  a DAEMON_STATS request asks for.
+
+  Only used between a client and a daemon built from the same tree, so
+  everything is sent in host byte order.
+*/
+inline constexpr uint32_t DAEMON_MAGIC = 0x4443524f; // "ORCD"
+inline constexpr uint32_t DAEMON_VERSION = 1;
+
+enum DaemonRequestKind : uint32_t {
+  DAEMON_COMPILE = 1,
+  DAEMON_STATS = 2,
+};
+
+struct DaemonRequest {
+  uint32_t magic = DAEMON_MAGIC;
+  uint32_t version = DAEMON_VERSION;
+  uint32_t kind = DAEMON_COMPILE;
+  uint32_t size = 0;
+};
+
+// Number of descriptors sent with a request: stdin, stdout and stderr.
+inline constexpr int DAEMON_FD_COUNT = 3;
+
+// Both return false on any error, or if the other end hung up early.
+bool daemon_write_all(int fd, const void *data, size_t size);
+bool daemon_read_all(int fd, void *data, size_t size);
+
+// Socket connected to the daemon listening at `path`, -1 on failure.
+int daemon_connect(const std::string &path);
+
+bool daemon_send_request(int fd, DaemonRequest request,
+                         const std::vector<std::string> &strings);
+// Reads a request header and the descriptors that came with it, which the
+// caller owns afterwards. Fails on a request from another version.
+bool daemon_receive_request(int fd, DaemonRequest &request,
+                            int fds[DAEMON_FD_COUNT]);
+// Splits the bytes that follow a request header into its strings, fails if
+// the last one is not terminated.
+bool daemon_parse_strings(const std::string &payload,
+                          std::vector<std::string> &strings);
@@ -0,0 +1,722 @@
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/SHA1.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/xxhash.h>
+#include <string>
+
+#include "compile_error.h"
+#include "flat_ast.h"
+#include "utils.h"
+
+/* Flattening */
+
+namespace {
+
+enum ChildSlot : uint8_t { SLOT_A, SLOT_B, SLOT_C, SLOT_LIST };
+
+/*
+  A node waiting to be flattened. Once it has an index, that index is
+  stored in field `slot` of node `owner`, or in entry `owner` of the list
+  array for SLOT_LIST.
+*/
+struct PendingNode {
+  AST_Node *node;
+  uint32_t owner;
+  ChildSlot slot;
+};
+
+} // namespace
+
+/*
+  Walks the pointer AST with an explicit stack, so deeply nested programs
+  cost no native stack here either. Children are pushed in reverse and
+  popped in order, which lays the nodes out in pre-order.
+*/
+class FlatBuilder {
+public:
+  FlatBuilder(FlatAST::Storage &ast) : ast(ast) {}
+
+  void run(AST_Node *root, const StringInterner &interner);
+
+private:
+  FlatAST::Storage &ast;
+  llvm::DenseMap<const OrcType *, TypeIndex> type_indices;
+  std::vector<PendingNode> pending;
+  llvm::SmallVector<PendingNode, 8> children;
+
+  TypeIndex add_type(const OrcType *type);
+  uint32_t add_bytes(std::string_view text);
+  void add_child(AST_Node *child, uint32_t owner, ChildSlot slot);
+  // Reserves entries in the list array for the non-EOF nodes of `nodes`.
+  template <typename T>
+  uint32_t add_list(const ArenaVector<T> &nodes, uint32_t &count);
+  void flatten(AST_Node *node, NodeIndex index);
+};
+
+FlatAST FlatAST::build(AST_Node *root, const StringInterner &interner) {
+  FlatAST ast;
+  ast.storage = std::make_unique<Storage>();
+  FlatBuilder(*ast.storage).run(root, interner);
+
+  ast.nodes = ast.storage->nodes;
+  ast.lists = ast.storage->lists;
+  ast.types = ast.storage->types;
+  ast.symbol_offsets = ast.storage->symbol_offsets;
+  ast.bytes = ast.storage->bytes;
+  return ast;
+}
+
+void FlatBuilder::run(AST_Node *root, const StringInterner &interner) {
+  // Every symbol is copied in id order, so the ids stored in the nodes, and
+  // the well-known ones, stay valid without the interner.
+  this->ast.symbol_offsets.reserve(interner.size() + 1);
+  for (Symbol symbol = 0; symbol < interner.size(); ++symbol) {
+    this->ast.symbol_offsets.push_back(this->ast.bytes.size());
+    std::string_view text = interner.text(symbol);
+    this->ast.bytes.insert(this->ast.bytes.end(), text.begin(), text.end());
+  }
+  this->ast.symbol_offsets.push_back(this->ast.bytes.size());
+
+  this->pending.push_back({root, NO_NODE, SLOT_A});
+
+  while (!this->pending.empty()) {
+    PendingNode next = this->pending.back();
+    this->pending.pop_back();
+
+    NodeIndex index = this->ast.nodes.size();
+    if (next.slot == SLOT_LIST) {
+      this->ast.lists[next.owner] = index;
+    } else if (next.slot == SLOT_A && next.owner != NO_NODE) {
+      this->ast.nodes[next.owner].a = index;
+    } else if (next.slot == SLOT_B) {
+      this->ast.nodes[next.owner].b = index;
+    } else if (next.slot == SLOT_C) {
+      this->ast.nodes[next.owner].c = index;
+    }
+
+    this->flatten(next.node, index);
+
+    this->pending.insert(this->pending.end(), this->children.rbegin(),
+                         this->children.rend());
+    this->children.clear();
+  }
+}
+
+TypeIndex FlatBuilder::add_type(const OrcType *type) {
+  if (type == nullptr)
+    return NO_TYPE;
+
+  auto found = this->type_indices.find(type);
+  if (found != this->type_indices.end())
+    return found->second;
+
+  FlatType flat{};
+  flat.kind = type->kind;
+  flat.element = this->add_type(type->element);
+  flat.length = type->length;
+  flat.name = type->name;
+
+  TypeIndex index = this->ast.types.size();
+  this->ast.types.push_back(flat);
+  this->type_indices[type] = index;
+  return index;
+}
+
+uint32_t FlatBuilder::add_bytes(std::string_view text) {
+  uint32_t offset = this->ast.bytes.size();
+  this->ast.bytes.insert(this->ast.bytes.end(), text.begin(), text.end());
+  return offset;
+}
+
+void FlatBuilder::add_child(AST_Node *child, uint32_t owner, ChildSlot slot) {
+  if (child != nullptr)
+    this->children.push_back({child, owner, slot});
+}
+
+template <typename T>
+uint32_t FlatBuilder::add_list(const ArenaVector<T> &nodes, uint32_t &count) {
+  uint32_t first = this->ast.lists.size();
+
+  for (AST_Node *node : nodes) {
+    if (node->get_type() == AST_NODE_EOF)
+      continue;
+    this->add_child(node, this->ast.lists.size(), SLOT_LIST);
+    this->ast.lists.push_back(NO_NODE);
+  }
+
+  count = this->ast.lists.size() - first;
+  return first;
+}
+
+void FlatBuilder::flatten(AST_Node *node, NodeIndex index) {
+  FlatNode flat{};
+  flat.kind = node->get_type();
+  flat.type = this->add_type(node->value_type);
+  flat.a = flat.b = flat.c = NO_NODE;
+
+  switch (node->get_type()) {
+  case AST_NODE_INTEGER_LITERAL:
+    flat.a = ((AST_IntegerLiteral *)node)->get_value();
+    break;
+
+  case AST_NODE_FLOAT_LITERAL: {
+    std::string_view text = ((AST_FloatLiteral *)node)->value;
+    flat.a = this->add_bytes(text);
+    flat.b = text.size();
+    break;
+  }
+
+  case AST_NODE_STRING_LITERAL: {
+    std::string_view text = ((AST_StringLiteral *)node)->value;
+    flat.a = this->add_bytes(text);
+    flat.b = text.size();
+    break;
+  }
+
+  case AST_NODE_VARIABLE_REFERENCE:
+    flat.a = ((AST_VariableReference *)node)->name;
+    break;
+
+  case AST_NODE_VARIABLE_DECLARATION: {
+    AST_VariableDeclaration *decl = (AST_VariableDeclaration *)node;
+    flat.a = decl->name;
+    flat.c = decl->type;
+    if (decl->is_mutated)
+      flat.flags |= FLAT_MUTATED;
+    this->add_child(decl->value, index, SLOT_B);
+    break;
+  }
+
+  case AST_NODE_VARIABLE_ASSIGNMENT: {
+    AST_VariableAssignment *assign = (AST_VariableAssignment *)node;
+    flat.a = assign->name;
+    this->add_child(assign->value, index, SLOT_B);
+    break;
+  }
+
+  case AST_NODE_BLOCK: {
+    AST_Block *block = (AST_Block *)node;
+    flat.a = this->add_list(block->nodes, flat.b);
+    flat.c = block->block_name;
+    if (block->is_array)
+      flat.flags |= FLAT_ARRAY;
+    if (block->is_constant)
+      flat.flags |= FLAT_CONSTANT;
+    if (block->block_type == "struct")
+      flat.flags |= FLAT_STRUCT;
+    break;
+  }
+
+  case AST_FUNCTION_ARGUMENT: {
+    AST_FunctionArgument *arg = (AST_FunctionArgument *)node;
+    flat.a = arg->name;
+    flat.b = arg->type;
+    break;
+  }
+
+  case AST_FUNCTION_DEFINITION: {
+    AST_FunctionDefinition *func = (AST_FunctionDefinition *)node;
+    flat.a = func->name;
+    flat.b = this->add_list(func->args, flat.c);
+    this->add_child(func->body, this->ast.lists.size(), SLOT_LIST);
+    this->ast.lists.push_back(NO_NODE);
+    flat.c += 1;
+    break;
+  }
+
+  case AST_FUNCTION_CALL: {
+    AST_FunctionCall *call = (AST_FunctionCall *)node;
+    flat.a = call->name;
+    flat.b = this->add_list(call->args, flat.c);
+    break;
+  }
+
+  case AST_BINARY_OPERATION: {
+    AST_BinaryOperation *bin_op = (AST_BinaryOperation *)node;
+    flat.op = bin_op->op;
+    this->add_child(bin_op->left, index, SLOT_A);
+    this->add_child(bin_op->right, index, SLOT_B);
+    break;
+  }
+
+  case AST_CONDITIONAL: {
+    AST_Conditional *conditional = (AST_Conditional *)node;
+    this->add_child(conditional->condition, index, SLOT_A);
+    this->add_child(conditional->onTrue, index, SLOT_B);
+    this->add_child(conditional->onFalse, index, SLOT_C);
+    break;
+  }
+
+  case AST_LOOP: {
+    AST_Loop *loop = (AST_Loop *)node;
+    this->add_child(loop->condition, index, SLOT_A);
+    this->add_child(loop->expression, index, SLOT_B);
+    break;
+  }
+
+  default:
+    break;
+  }
+
+  this->ast.nodes.push_back(flat);
+}
+
+/* FlatAST */
+
+std::span<const NodeIndex> FlatAST::children(const FlatNode &node) const {
+  if (node.node_type() == AST_NODE_BLOCK)
+    return this->list(node.a, node.b);
+  return this->list(node.b, node.c);
+}
+
+std::string_view FlatAST::text(Symbol symbol) const {
+  if (symbol == NO_SYMBOL)
+    return std::string_view();
+
+  uint32_t begin = this->symbol_offsets[symbol];
+  return {this->bytes.data() + begin, this->symbol_offsets[symbol + 1] - begin};
+}
+
+std::string FlatAST::type_name(TypeIndex index) const {
+  if (index == NO_TYPE)
+    return "";
+
+  const FlatType &type = this->types[index];
+  switch (type.type_kind()) {
+  case ORC_TYPE_VOID:
+    return "void";
+  case ORC_TYPE_INT:
+    return "int";
+  case ORC_TYPE_BOOL:
+    return "bool";
+  case ORC_TYPE_FLOAT:
+    return "float";
+  case ORC_TYPE_STRING:
+    return "string";
+  case ORC_TYPE_ARRAY:
+    return this->type_name(type.element) + "[" + std::to_string(type.length) +
+           "]";
+  case ORC_TYPE_STRUCT:
+    return std::string(this->text(type.name));
+  }
+
+  return "";
+}
+
+size_t FlatAST::memory_usage() const {
+  return this->nodes.size() * sizeof(FlatNode) +
+         this->lists.size() * sizeof(NodeIndex) +
+         this->types.size() * sizeof(FlatType) +
+         this->symbol_offsets.size() * sizeof(uint32_t) + this->bytes.size();
+}
+
+/* Saving and mapping */
+
+/*
+  Bump whenever the layout below, or the AST built for a given source,
+  changes. A saved AST is its header followed by the node, list, type,
+  symbol offset and byte arrays, each exactly as they are in memory. All
+  but the last are made of 4-byte words, so each array stays aligned in the
+  mapped file. The checksum covers everything after the header.
+*/
+static constexpr uint32_t FLAT_AST_FORMAT = 2;
+static constexpr uint32_t FLAT_AST_MAGIC = 0x5453414f; // "OAST"
+
+namespace {
+
+struct FlatASTHeader {
+  uint32_t magic;
+  uint32_t format;
+  uint64_t checksum;
+  SourceKey key;
+  uint32_t node_count;
+  uint32_t list_count;
+  uint32_t type_count;
+  uint32_t symbol_offset_count;
+  uint32_t byte_count;
+};
+
+} // namespace
+
+template <typename T>
+static void write_array(llvm::raw_ostream &output, std::span<const T> array) {
+  output.write((const char *)array.data(), array.size_bytes());
+}
+
+// Points `array` at the next `count` items of `data`, which must hold them.
+template <typename T>
+static bool map_array(std::string_view &data, std::span<const T> &array,
+                      uint32_t count) {
+  if (data.size() / sizeof(T) < count)
+    return false;
+
+  array = {(const T *)data.data(), count};
+  data.remove_prefix(count * sizeof(T));
+  return true;
+}
+
+SourceKey FlatAST::source_key(std::string_view source) {
+  llvm::SHA1 hasher;
+  uint32_t format = FLAT_AST_FORMAT;
+  hasher.update(llvm::ArrayRef<uint8_t>((const uint8_t *)&format,
+                                        sizeof(format)));
+  hasher.update(llvm::StringRef(source.data(), source.size()));
+
+  SourceKey key;
+  std::memcpy(key.data(), hasher.final().data(), key.size());
+  return key;
+}
+
+void FlatAST::save(const std::string &path, const SourceKey &key) const {
+  llvm::SmallString<128> temporary;
+  int fd = -1;
+  std::error_code ec =
+      llvm::sys::fs::createUniqueFile(path + ".tmp-%%%%%%%%", fd, temporary);
+  if (ec) {
+    std::cout << "Error! Could not create a file next to `" << path
+              << "`: " << ec.message() << "\n";
+    throw CompileError();
+  }
+
+  std::string body;
+  {
+    llvm::raw_string_ostream output(body);
+    write_array(output, this->nodes);
+    write_array(output, this->lists);
+    write_array(output, this->types);
+    write_array(output, this->symbol_offsets);
+    write_array(output, this->bytes);
+  }
+
+  FlatASTHeader header = {FLAT_AST_MAGIC,
+                          FLAT_AST_FORMAT,
+                          llvm::xxHash64(body),
+                          key,
+                          (uint32_t)this->nodes.size(),
+                          (uint32_t)this->lists.size(),
+                          (uint32_t)this->types.size(),
+                          (uint32_t)this->symbol_offsets.size(),
+                          (uint32_t)this->bytes.size()};
+
+  {
+    llvm::raw_fd_ostream output(fd, true);
+    output.write((const char *)&header, sizeof(header));
+    output << body;
+  }
+
+  ec = llvm::sys::fs::rename(temporary, path);
+  if (ec) {
+    llvm::sys::fs::remove(temporary);
+    std::cout << "Error! Could not write `" << path << "`: " << ec.message()
+              << "\n";
+    throw CompileError();
+  }
+}
+
+std::optional<FlatAST> FlatAST::map(const std::string &path,
+                                    const SourceKey &key) {
+  auto file = std::make_unique<SourceFile>();
+  if (!file->open(path))
+    return std::nullopt;
+
+  std::string_view data = file->view();
+  FlatASTHeader header;
+  if (data.size() < sizeof(header))
+    return std::nullopt;
+
+  std::memcpy(&header, data.data(), sizeof(header));
+  data.remove_prefix(sizeof(header));
+
+  if (header.magic != FLAT_AST_MAGIC || header.format != FLAT_AST_FORMAT ||
+      header.key != key)
+    return std::nullopt;
+
+  // Files are only ever renamed into place whole, this guards against
+  // one that was cut short or damaged some other way. The shape of a file
+  // that still matches is checked again by is_valid() before it is read.
+  if (header.checksum != llvm::xxHash64(llvm::StringRef(data.data(),
+                                                         data.size())))
+    return std::nullopt;
+
+  FlatAST ast;
+  if (!map_array(data, ast.nodes, header.node_count) ||
+      !map_array(data, ast.lists, header.list_count) ||
+      !map_array(data, ast.types, header.type_count) ||
+      !map_array(data, ast.symbol_offsets, header.symbol_offset_count) ||
+      !map_array(data, ast.bytes, header.byte_count) || !data.empty() ||
+      !ast.is_valid())
+    return std::nullopt;
+
+  ast.file = std::move(file);
+  return ast;
+}
+
+/*
+  Checks the shape of a mapped file: every index stays inside its arrays,
+  every node but the root has a type, and the nodes Codegen expects to be
+  blocks, like function bodies and both branches of a conditional, are.
+  Children come after their parent in pre-order and element types before
+  the types made of them, so requiring that as well also rules out cycles.
+  Whether names resolve and types agree is not checked again, that is
+  Sema's work, and the checksum is what guards it.
+*/
+bool FlatAST::is_valid() const {
+  if (this->nodes.empty() || this->symbol_offsets.empty() ||
+      this->nodes[0].node_type() != AST_NODE_BLOCK)
+    return false;
+
+  for (size_t i = 1; i < this->symbol_offsets.size(); ++i) {
+    if (this->symbol_offsets[i] < this->symbol_offsets[i - 1])
+      return false;
+  }
+  if (this->symbol_offsets.back() > this->bytes.size())
+    return false;
+
+  auto symbol_ok = [&](Symbol symbol) {
+    return symbol == NO_SYMBOL || symbol < this->symbol_offsets.size() - 1;
+  };
+  auto type_ok = [&](TypeIndex type, size_t limit) {
+    return type == NO_TYPE || type < limit;
+  };
+
+  for (size_t i = 0; i < this->types.size(); ++i) {
+    const FlatType &type = this->types[i];
+    if (type.kind > ORC_TYPE_STRUCT || !type_ok(type.element, i) ||
+        !symbol_ok(type.name) ||
+        (type.kind == ORC_TYPE_ARRAY && type.element == NO_TYPE))
+      return false;
+  }
+
+  for (size_t i = 0; i < this->nodes.size(); ++i) {
+    const FlatNode &node = this->nodes[i];
+    auto child_ok = [&](NodeIndex child) {
+      return child > i && child < this->nodes.size();
+    };
+    auto block_ok = [&](NodeIndex child) {
+      return child_ok(child) &&
+             this->nodes[child].node_type() == AST_NODE_BLOCK;
+    };
+    auto list_ok = [&](uint32_t first, uint32_t count) {
+      if (first > this->lists.size() || count > this->lists.size() - first)
+        return false;
+      for (NodeIndex child : this->list(first, count)) {
+        if (!child_ok(child))
+          return false;
+      }
+      return true;
+    };
+
+    if (!type_ok(node.type, this->types.size()) ||
+        (i > 0 && node.type == NO_TYPE))
+      return false;
+
+    bool ok = false;
+    switch (node.node_type()) {
+    case AST_NODE_INTEGER_LITERAL:
+      ok = true;
+      break;
+    case AST_NODE_FLOAT_LITERAL:
+    case AST_NODE_STRING_LITERAL:
+      ok = node.a <= this->bytes.size() &&
+           node.b <= this->bytes.size() - node.a;
+      break;
+    case AST_NODE_VARIABLE_REFERENCE:
+      ok = symbol_ok(node.a);
+      break;
+    case AST_NODE_VARIABLE_DECLARATION:
+      ok = symbol_ok(node.a) && child_ok(node.b) && symbol_ok(node.c);
+      break;
+    case AST_NODE_VARIABLE_ASSIGNMENT:
+      ok = symbol_ok(node.a) && child_ok(node.b);
+      break;
+    case AST_NODE_BLOCK: {
+      ok = list_ok(node.a, node.b) && symbol_ok(node.c);
+      if (!ok)
+        break;
+      // The root holds functions and structs, and a struct holds fields.
+      for (NodeIndex child : this->list(node.a, node.b)) {
+        const FlatNode &item = this->nodes[child];
+        if (i == 0)
+          ok = ok && (item.node_type() == AST_FUNCTION_DEFINITION ||
+                      (item.node_type() == AST_NODE_BLOCK &&
+                       item.has(FLAT_STRUCT)));
+        else if (node.has(FLAT_STRUCT))
+          ok = ok && item.node_type() == AST_FUNCTION_ARGUMENT;
+      }
+      break;
+    }
+    case AST_FUNCTION_ARGUMENT:
+      ok = symbol_ok(node.a) && symbol_ok(node.b);
+      break;
+    case AST_FUNCTION_DEFINITION: {
+      // The arguments come first and the body is the last item.
+      ok = symbol_ok(node.a) && node.c > 0 && list_ok(node.b, node.c);
+      if (!ok)
+        break;
+      std::span<const NodeIndex> items = this->list(node.b, node.c);
+      for (NodeIndex arg : items.first(items.size() - 1))
+        ok = ok && this->nodes[arg].node_type() == AST_FUNCTION_ARGUMENT;
+      ok = ok && block_ok(items.back());
+      break;
+    }
+    case AST_FUNCTION_CALL:
+      ok = symbol_ok(node.a) && list_ok(node.b, node.c);
+      break;
+    case AST_BINARY_OPERATION:
+      ok = node.op < BINARY_OP_COUNT && child_ok(node.a) && child_ok(node.b);
+      break;
+    case AST_CONDITIONAL:
+      ok = child_ok(node.a) && block_ok(node.b) && block_ok(node.c);
+      break;
+    case AST_LOOP:
+      ok = child_ok(node.a) && block_ok(node.b);
+      break;
+    default:
+      break;
+    }
+    if (!ok)
+      return false;
+  }
+
+  return true;
+}
+
+/* Printing */
+
+void FlatAST::print(NodeIndex index, int indent) const {
+  const FlatNode &node = this->nodes[index];
+  std::string pad = boom_utils::indent_string(indent);
+  std::string inner = boom_utils::indent_string(indent + 1);
+
+  switch (node.node_type()) {
+  case AST_NODE_INTEGER_LITERAL:
+    printf("%sIntegerLiteral(%d)\n", pad.c_str(), (int32_t)node.a);
+    break;
+
+  case AST_NODE_FLOAT_LITERAL:
+    printf("%sFloatLiteral(%s)\n", pad.c_str(),
+           std::string(this->literal(node)).c_str());
+    break;
+
+  case AST_NODE_STRING_LITERAL:
+    printf("%sStringLiteral(%s)\n", pad.c_str(),
+           boom_utils::trim_string(std::string(this->literal(node))).c_str());
+    break;
+
+  case AST_NODE_VARIABLE_REFERENCE:
+    printf("%sVariableReference(%s)\n", pad.c_str(),
+           std::string(this->text(node.a)).c_str());
+    break;
+
+  case AST_NODE_VARIABLE_DECLARATION:
+    printf("%sVariableDeclaration(\n%s%s\n%s%s\n", pad.c_str(), inner.c_str(),
+           std::string(this->text(node.a)).c_str(), inner.c_str(),
+           std::string(this->text(node.c)).c_str());
+    this->print(node.b, indent + 1);
+    printf("%s)\n", pad.c_str());
+    break;
+
+  case AST_NODE_VARIABLE_ASSIGNMENT:
+    printf("%sVariableAssignment(\n%s%s\n", pad.c_str(), inner.c_str(),
+           std::string(this->text(node.a)).c_str());
+    this->print(node.b, indent + 1);
+    printf("%s)\n", pad.c_str());
+    break;
+
+  case AST_NODE_BLOCK:
+    if (node.b == 0) {
+      printf("%sBlock{}\n", pad.c_str());
+      break;
+    }
+
+    printf("%sBlock[name=%s, type=%s]{\n", pad.c_str(),
+           std::string(this->text(node.c)).c_str(),
+           node.has(FLAT_STRUCT) ? "struct" : "");
+    for (NodeIndex child : this->list(node.a, node.b))
+      this->print(child, indent + 1);
+    printf("%s}\n", pad.c_str());
+    break;
+
+  case AST_FUNCTION_ARGUMENT:
+    printf("%sFunctionArgument(\n%s%s\n%s%s\n", pad.c_str(), inner.c_str(),
+           std::string(this->text(node.a)).c_str(), inner.c_str(),
+           std::string(this->text(node.b)).c_str());
+    printf("%s)\n", pad.c_str());
+    break;
+
+  case AST_FUNCTION_DEFINITION: {
+    std::span<const NodeIndex> items = this->list(node.b, node.c);
+
+    printf("%sFunctionDefinition<%s>(\n%s%s\n", pad.c_str(),
+           this->type_name(node.type).c_str(), inner.c_str(),
+           std::string(this->text(node.a)).c_str());
+    printf("%sArguments(\n", inner.c_str());
+    for (NodeIndex arg : items.first(items.size() - 1))
+      this->print(arg, indent + 2);
+    printf("%s)\n", inner.c_str());
+    this->print(items.back(), indent + 1);
+    printf("%s)\n", pad.c_str());
+    break;
+  }
+
+  case AST_FUNCTION_CALL:
+    printf("%sFunctionCall(\n%s%s\n", pad.c_str(), inner.c_str(),
+           std::string(this->text(node.a)).c_str());
+    printf("%sArguments(\n", inner.c_str());
+    for (NodeIndex arg : this->list(node.b, node.c))
+      this->print(arg, indent + 2);
+    printf("%s)\n", inner.c_str());
+    printf("%s)\n", pad.c_str());
+    break;
+
+  case AST_BINARY_OPERATION: {
+    // Chains of left operands are walked iteratively, as in codegen.
+    llvm::SmallVector<NodeIndex, 16> spine{index};
+    while (this->nodes[this->nodes[spine.back()].a].node_type() ==
+           AST_BINARY_OPERATION)
+      spine.push_back(this->nodes[spine.back()].a);
+
+    // The whole chain is printed at one indent, a deeper indent per link
+    // would make the dump quadratic in the length of the chain.
+    for (NodeIndex operation : spine) {
+      printf("%sBinaryOperation(\n", pad.c_str());
+      printf("%s%s\n", inner.c_str(),
+             binary_op_name(this->nodes[operation].binary_op()));
+    }
+
+    this->print(this->nodes[spine.back()].a, indent + 1);
+
+    for (size_t i = spine.size(); i-- > 0;) {
+      this->print(this->nodes[spine[i]].b, indent + 1);
+      printf("%s)\n", pad.c_str());
+    }
+    break;
+  }
+
+  case AST_CONDITIONAL:
+    printf("%sConditional(\n", pad.c_str());
+    this->print(node.a, indent + 1);
+    this->print(node.b, indent + 1);
+    if (node.c != NO_NODE)
+      this->print(node.c, indent + 1);
+    printf("%s)\n", pad.c_str());
+    break;
+
+  case AST_LOOP:
+    printf("%sLoop(\n", pad.c_str());
+    this->print(node.a, indent + 1);
+    this->print(node.b, indent + 1);
+    printf("%s)\n", pad.c_str());
+    break;
+
+  default:
+    printf("%sAST_Node\n", pad.c_str());
+    break;
+  }
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ast.h"
+#include "interner.h"
+#include "source_file.h"
+#include "types.h"
+
+using NodeIndex = uint32_t;
+using TypeIndex = uint32_t;
+
+inline constexpr NodeIndex NO_NODE = UINT32_MAX;
+inline constexpr TypeIndex NO_TYPE = UINT32_MAX;
+
+enum FlatNodeFlag : uint8_t {
+  // Block is an array literal.
+  FLAT_ARRAY = 1 << 0,
+  // Block is an array literal made only of integer literals.
+  FLAT_CONSTANT = 1 << 1,
+  // Block is a struct definition.
+  FLAT_STRUCT = 1 << 2,
+  // VariableDeclaration whose variable is written to later.
+  FLAT_MUTATED = 1 << 3,
+};
+
+/*
+  One node of the flat AST. Children are referenced by their index in
+  FlatAST's node array and lists of children by a range of FlatAST's list
+  array. What a, b and c hold depends on the kind:
+
+    IntegerLiteral       value
+    FloatLiteral         text offset, text length
+    StringLiteral        text offset, text length
+    VariableReference    name
+    VariableDeclaration  name, value, declared type name
+    VariableAssignment   name, value
+    Block                first child, child count, struct name
+    FunctionArgument     name, declared type name
+    FunctionDefinition   name, first child, child count (arguments, then body)
+    FunctionCall         name, first argument, argument count
+    BinaryOperation      left, right
+    Conditional          condition, then block, else block
+    Loop                 condition, body block
+*/
+struct FlatNode {
+  uint8_t kind;
+  uint8_t op;
+  uint8_t flags;
+  uint8_t reserved;
+  // Type Sema gave the node, NO_TYPE only on the root block.
+  TypeIndex type;
+  uint32_t a;
+  uint32_t b;
+  uint32_t c;
+
+  AST_Node_Type node_type() const { return (AST_Node_Type)this->kind; }
+  BinaryOp binary_op() const { return (BinaryOp)this->op; }
+  bool has(FlatNodeFlag flag) const { return (this->flags & flag) != 0; }
+};
+
+static_assert(sizeof(FlatNode) == 20, "FlatNode is meant to stay packed");
+
+// Hash of a source file, see FlatAST::source_key().
+using SourceKey = std::array<uint8_t, 20>;
+
+// OrcType with its element type given by index, see FlatAST::type().
+struct FlatType {
+  uint8_t kind;
+  uint8_t reserved[3];
+  TypeIndex element;
+  uint32_t length;
+  Symbol name;
+
+  OrcTypeKind type_kind() const { return (OrcTypeKind)this->kind; }
+  bool is_aggregate() const {
+    return this->kind == ORC_TYPE_ARRAY || this->kind == ORC_TYPE_STRUCT;
+  }
+};
+
+/*
+  The program after Sema, stored as a handful of flat arrays of plain data:
+  nodes in pre-order, so every function is a contiguous range of nodes,
+  child lists, types, and the bytes of every string literal and symbol.
+  Blocks and argument lists hold no EOF sentinels. The AST refers to no
+  other object, so it can be traversed without chasing pointers and written
+  out as-is. Node 0 is the program's top-level block.
+
+  A built AST owns its arrays. One saved by save() is read back by map(),
+  which points the arrays straight into the mapped file.
+*/
+class FlatAST {
+public:
+  // Flattens `root`, which must have been checked by Sema.
+  static FlatAST build(AST_Node *root, const StringInterner &interner);
+
+  // Key an AST built from `source` is saved under. It covers the file
+  // format as well, so files from other compiler versions do not match.
+  static SourceKey source_key(std::string_view source);
+  // Writes the AST to `path`, tagged with `key`. The file is written
+  // under a temporary name and renamed into place, so map() never sees
+  // half of it.
+  void save(const std::string &path, const SourceKey &key) const;
+  // Maps an AST saved with `key`. Empty if `path` does not exist, holds
+  // the AST of another source or compiler version, or is damaged.
+  static std::optional<FlatAST> map(const std::string &path,
+                                    const SourceKey &key);
+
+  NodeIndex root() const { return 0; }
+  size_t size() const { return this->nodes.size(); }
+
+  const FlatNode &node(NodeIndex index) const { return this->nodes[index]; }
+  std::span<const NodeIndex> list(uint32_t first, uint32_t count) const {
+    return {this->lists.data() + first, count};
+  }
+  // Children of a Block, arguments of a FunctionCall.
+  std::span<const NodeIndex> children(const FlatNode &node) const;
+
+  const FlatType &type(TypeIndex index) const { return this->types[index]; }
+  const FlatType &type_of(const FlatNode &node) const {
+    return this->types[node.type];
+  }
+  std::string type_name(TypeIndex index) const;
+
+  // NO_SYMBOL reads as the empty string, like StringInterner::text().
+  std::string_view text(Symbol symbol) const;
+  // Text of a string or float literal.
+  std::string_view literal(const FlatNode &node) const {
+    return {this->bytes.data() + node.a, node.b};
+  }
+
+  size_t memory_usage() const;
+
+  void print() const { this->print(this->root(), 0); }
+  void print(NodeIndex index, int indent) const;
+
+private:
+  friend class FlatBuilder;
+
+  // Whether every index in the arrays points inside them, checked on the
+  // arrays of a mapped file before anything reads through them.
+  bool is_valid() const;
+
+  struct Storage {
+    std::vector<FlatNode> nodes;
+    std::vector<NodeIndex> lists;
+    std::vector<FlatType> types;
+    std::vector<uint32_t> symbol_offsets;
+    std::vector<char> bytes;
+  };
+
+  // Arrays of a built AST, null for a mapped one.
+  std::unique_ptr<Storage> storage;
+  // File a mapped AST points into, null for a built one.
+  std::unique_ptr<SourceFile> file;
+
+  std::span<const FlatNode> nodes;
+  std::span<const NodeIndex> lists;
+  std::span<const FlatType> types;
+  // Symbol s spans bytes [symbol_offsets[s], symbol_offsets[s + 1]).
+  std::span<const uint32_t> symbol_offsets;
+  std::span<const char> bytes;
+};
@@ -0,0 +1,77 @@
+#include "interner.h"
+
+StringInterner::StringInterner() : storage(16 * 1024) {
+  this->slots.resize(256, 0);
+
+  // Must match the order of WellKnownSymbol.
+  this->intern("return");
+  this->intern("printf");
+  this->intern("main");
+  this->intern("int");
+  this->intern("string");
+  this->intern("void");
+}
+
+uint32_t StringInterner::hash(std::string_view str) {
+  uint32_t hash = 2166136261u;
+  for (char c : str)
+    hash = (hash ^ (uint8_t)c) * 16777619u;
+  return hash;
+}
+
+size_t StringInterner::find_slot(std::string_view str, uint32_t hash) const {
+  size_t mask = this->slots.size() - 1;
+  size_t slot = hash & mask;
+
+  for (;;) {
+    uint32_t entry = this->slots[slot];
+    if (entry == 0)
+      return slot;
+
+    Symbol symbol = entry - 1;
+    if (this->hashes[symbol] == hash && this->texts[symbol] == str)
+      return slot;
+
+    slot = (slot + 1) & mask;
+  }
+}
+
+Symbol StringInterner::intern(std::string_view str) {
+  uint32_t hash = StringInterner::hash(str);
+  size_t slot = this->find_slot(str, hash);
+
+  if (this->slots[slot] != 0)
+    return this->slots[slot] - 1;
+
+  Symbol symbol = this->texts.size();
+  this->texts.push_back(this->storage.copy_string(str));
+  this->hashes.push_back(hash);
+  this->slots[slot] = symbol + 1;
+
+  // Keep the table at most half full so probe sequences stay short.
+  if (this->texts.size() * 2 > this->slots.size())
+    this->grow();
+
+  return symbol;
+}
+
+Symbol StringInterner::lookup(std::string_view str) const {
+  size_t slot = this->find_slot(str, StringInterner::hash(str));
+  return this->slots[slot] == 0 ? NO_SYMBOL : this->slots[slot] - 1;
+}
+
+void StringInterner::grow() {
+  std::vector<uint32_t> old_slots = std::move(this->slots);
+  this->slots.assign(old_slots.size() * 2, 0);
+
+  size_t mask = this->slots.size() - 1;
+  for (uint32_t entry : old_slots) {
+    if (entry == 0)
+      continue;
+
+    size_t slot = this->hashes[entry - 1] & mask;
+    while (this->slots[slot] != 0)
+      slot = (slot + 1) & mask;
+    this->slots[slot] = entry;
+  }
+}
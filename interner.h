@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "arena.h"
+
+using Symbol = uint32_t;
+
+inline constexpr Symbol NO_SYMBOL = UINT32_MAX;
+
+/*
+  Names the compiler itself needs to recognise. They are interned first and
+  in this order by every StringInterner, so their ids are the same in every
+  compilation.
+*/
+enum WellKnownSymbol : Symbol {
+  SYM_RETURN,
+  SYM_PRINTF,
+  SYM_MAIN,
+  SYM_INT,
+  SYM_STRING,
+  SYM_VOID,
+
+  WELL_KNOWN_SYMBOL_COUNT
+};
+
+/*
+  Maps every distinct identifier to a dense 32-bit symbol id. Interned text
+  is copied into the interner's own arena, so the views returned by text()
+  stay valid for as long as the interner lives.
+*/
+class StringInterner {
+public:
+  StringInterner();
+
+  StringInterner(const StringInterner &) = delete;
+  StringInterner &operator=(const StringInterner &) = delete;
+
+  Symbol intern(std::string_view str);
+  // Returns the symbol for `str`, or NO_SYMBOL if it was never interned.
+  Symbol lookup(std::string_view str) const;
+
+  // NO_SYMBOL reads as the empty string.
+  std::string_view text(Symbol symbol) const {
+    return symbol == NO_SYMBOL ? std::string_view() : this->texts[symbol];
+  }
+  size_t size() const { return this->texts.size(); }
+
+private:
+  Arena storage;
+  std::vector<std::string_view> texts;
+  std::vector<uint32_t> hashes;
+  // Open addressing table of symbol + 1, zero marks an empty slot.
+  std::vector<uint32_t> slots;
+
+  static uint32_t hash(std::string_view str);
+  size_t find_slot(std::string_view str, uint32_t hash) const;
+  void grow();
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "token.h"
+
+/*
+  Every token with a fixed spelling: keywords, operators and punctuation.
+  The lexer resolves them through a perfect hash that is generated at compile
+  time, so classifying a word or an operator costs one hash and at most one
+  short compare.
+*/
+struct FixedToken {
+  std::string_view spelling;
+  TokenIdentifier id;
+};
+
+inline constexpr FixedToken FIXED_TOKENS[] = {
+    {"var", TOKEN_KEYWORD_VAR},
+    {"func", TOKEN_KEYWORD_FUNC},
+    {"if", TOKEN_KEYWORD_IF},
+    {"else", TOKEN_KEYWORD_ELSE},
+    {"while", TOKEN_KEYWORD_WHILE},
+    {"struct", TOKEN_KEYWORD_STRUCT},
+
+    {"(", TOKEN_PAREN_OPEN},
+    {")", TOKEN_PAREN_CLOSE},
+    {"[", TOKEN_BRACKET_OPEN},
+    {"]", TOKEN_BRACKET_CLOSE},
+    {"{", TOKEN_BRACE_OPEN},
+    {"}", TOKEN_BRACE_CLOSE},
+    {".", TOKEN_PERIOD},
+    {",", TOKEN_COMMA},
+    {";", TOKEN_SEMICOLON},
+
+    {"+", TOKEN_OPERATOR_PLUS},
+    {"-", TOKEN_OPERATOR_MINUS},
+    {"*", TOKEN_OPERATOR_MULTIPLY},
+    {"/", TOKEN_OPERATOR_DIVIDE},
+    {"%", TOKEN_OPERATOR_MODULO},
+    {"<", TOKEN_ANGLE_OPEN},
+    {">", TOKEN_ANGLE_CLOSE},
+    {"=", TOKEN_OPERATOR_EQUALS},
+    {"==", TOKEN_OPERATOR_IS_EQUALS},
+};
+
+inline constexpr size_t FIXED_TOKEN_COUNT =
+    sizeof(FIXED_TOKENS) / sizeof(FIXED_TOKENS[0]);
+inline constexpr size_t FIXED_TOKEN_TABLE_SIZE = 64;
+
+constexpr uint32_t fixed_token_hash(std::string_view str, uint32_t seed) {
+  uint32_t hash = seed ^ (uint32_t)str.size();
+  for (char c : str)
+    hash = (hash ^ (uint8_t)c) * 16777619u;
+  return hash ^ (hash >> 15);
+}
+
+// Searches for the first seed under which no two fixed tokens collide.
+constexpr uint32_t find_fixed_token_seed() {
+  for (uint32_t seed = 1; seed < (1u << 16); ++seed) {
+    std::array<bool, FIXED_TOKEN_TABLE_SIZE> used{};
+    bool collides = false;
+
+    for (const FixedToken &token : FIXED_TOKENS) {
+      uint32_t slot =
+          fixed_token_hash(token.spelling, seed) % FIXED_TOKEN_TABLE_SIZE;
+      if (used[slot]) {
+        collides = true;
+        break;
+      }
+      used[slot] = true;
+    }
+
+    if (!collides)
+      return seed;
+  }
+  return 0;
+}
+
+inline constexpr uint32_t FIXED_TOKEN_SEED = find_fixed_token_seed();
+static_assert(FIXED_TOKEN_SEED != 0,
+              "no perfect hash seed found for the fixed tokens");
+
+// Slot -> index into FIXED_TOKENS plus one, zero marks an empty slot.
+inline constexpr std::array<uint8_t, FIXED_TOKEN_TABLE_SIZE>
+    FIXED_TOKEN_TABLE = [] {
+      std::array<uint8_t, FIXED_TOKEN_TABLE_SIZE> table{};
+      for (size_t i = 0; i < FIXED_TOKEN_COUNT; ++i)
+        table[fixed_token_hash(FIXED_TOKENS[i].spelling, FIXED_TOKEN_SEED) %
+              FIXED_TOKEN_TABLE_SIZE] = i + 1;
+      return table;
+    }();
+
+/*
+  Returns the dedicated token for `str` if it is a keyword, operator or
+  punctuation, and TOKEN_WORD otherwise.
+*/
+constexpr TokenIdentifier classify_fixed_token(std::string_view str) {
+  uint8_t entry = FIXED_TOKEN_TABLE[fixed_token_hash(str, FIXED_TOKEN_SEED) %
+                                    FIXED_TOKEN_TABLE_SIZE];
+  if (entry == 0 || FIXED_TOKENS[entry - 1].spelling != str)
+    return TOKEN_WORD;
+  return FIXED_TOKENS[entry - 1].id;
+}
+
+static_assert(classify_fixed_token("while") == TOKEN_KEYWORD_WHILE);
+static_assert(classify_fixed_token("==") == TOKEN_OPERATOR_IS_EQUALS);
+static_assert(classify_fixed_token("whilst") == TOKEN_WORD);
+
+// Returns the spelling of a fixed token, or an empty view for other tokens.
+constexpr std::string_view fixed_token_spelling(TokenIdentifier id) {
+  for (const FixedToken &token : FIXED_TOKENS)
+    if (token.id == id)
+      return token.spelling;
+  return "";
+}
@@ -1,194 +1,127 @@
+#include <algorithm>
+#include <array>
+
+#include "keywords.h"
 #include "lexer.h"
 #include "token.h"
 #include "utils.h"
 
-std::vector<Token> Lexer::lex() {
-  for (char c : this->source) {
-    this->buffer += c;
+static bool is_whitespace(char c) {
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
 
-    if (this->in_string) {
-      this->handle_string_char(c);
-      continue;
-    }
+// Characters that start an operator or punctuation token and end a word.
+static constexpr std::array<bool, 256> SPECIAL_CHARS = [] {
+  std::array<bool, 256> table{};
+  for (const FixedToken &token : FIXED_TOKENS)
+    if (token.spelling[0] < 'a' || token.spelling[0] > 'z')
+      table[(uint8_t)token.spelling[0]] = true;
+  return table;
+}();
 
-    if (this->in_number) {
-      this->handle_number_char(c);
-      if (this->in_number)
-        continue;
-    }
+static bool is_special_char(char c) { return SPECIAL_CHARS[(uint8_t)c]; }
 
-    bool handled_special_char = true;
-    std::string prev_buffer = "";
-    if (this->buffer.length() > 1)
-      prev_buffer = this->buffer.substr(0, this->buffer.length() - 1);
+TokenStream &Lexer::lex() {
+  // Source text averages well over four bytes per token, reserving up front
+  // keeps the token vector from being regrown over and over on big inputs.
+  this->tokens.reserve(this->source.size() / 4 + 1);
 
-    switch (c) {
-    case QUOTE_DOUBLE:
-    case QUOTE_SINGLE:
-      this->handle_quote_char(c);
-      handled_special_char = false;
-      break;
+  while (this->cursor < this->source.size()) {
+    char c = this->source[this->cursor];
 
-    // If we've hit whitespace, or a new line, and are not
-    // currently processing a string or number, then we can
-    // safely assume the current contents of the buffer is
-    // a word token.
-    case ' ':
-    case '\n':
-      if (buffer != " ")
-        this->push_token(TOKEN_WORD,
-                         this->buffer.substr(0, this->buffer.length() - 1));
-      this->clear_buffer();
-      handled_special_char = false;
-      break;
+    if (is_whitespace(c)) {
+      ++this->cursor;
+      continue;
+    }
 
-    case '(':
-      this->push_token(TOKEN_PAREN_OPEN, "(");
-      break;
-    case ')':
-      this->push_token(TOKEN_PAREN_CLOSE, ")");
-      break;
-    case '[':
-      this->push_token(TOKEN_BRACKET_OPEN, "[");
-      break;
-    case ']':
-      this->push_token(TOKEN_BRACKET_CLOSE, "]");
-      break;
-    case '{':
-      this->push_token(TOKEN_BRACE_OPEN, "{");
-      break;
-    case '}':
-      this->push_token(TOKEN_BRACE_CLOSE, "}");
-      break;
-    case '<':
-      this->push_token(TOKEN_ANGLE_OPEN, "<");
-      break;
-    case '>':
-      this->push_token(TOKEN_ANGLE_CLOSE, ">");
-      break;
-    case '.':
-      this->push_token(TOKEN_PERIOD, ".");
-      break;
+    if (c == QUOTE_DOUBLE || c == QUOTE_SINGLE) {
+      this->lex_string(c);
+      continue;
+    }
 
-    case ',':
-      this->push_token(TOKEN_COMMA, ",");
-      break;
-    case ';':
-      this->push_token(TOKEN_SEMICOLON, ";");
-      break;
+    if (boom_utils::is_digit(c)) {
+      this->lex_number();
+      continue;
+    }
 
-    case '*':
-      this->push_token(TOKEN_OPERATOR_MULTIPLY, "*");
-      break;
-    case '+':
-      this->push_token(TOKEN_OPERATOR_PLUS, "+");
-      break;
-    case '-':
-      this->push_token(TOKEN_OPERATOR_MINUS, "-");
-      break;
-    case '/':
-      this->push_token(TOKEN_OPERATOR_DIVIDE, "/");
-      break;
-    case '%':
-      this->push_token(TOKEN_OPERATOR_MODULO, "%");
-      break;
-    case '=':
-      if (this->tokens.back().id == TOKEN_OPERATOR_EQUALS) {
-        this->tokens.pop_back();
-        this->push_token(TOKEN_OPERATOR_IS_EQUALS, "==");
-      } else {
-        this->push_token(TOKEN_OPERATOR_EQUALS, "=");
-      }
-      break;
+    if (!is_special_char(c)) {
+      this->lex_word();
+      continue;
+    }
 
-    default:
-      if (boom_utils::is_digit(c))
-        this->in_number = true;
+    // Operators are at most two characters long, prefer the longer match.
+    TokenIdentifier id =
+        classify_fixed_token(this->source.substr(this->cursor, 2));
+    uint32_t length = 2;
 
-      handled_special_char = false;
-      break;
+    if (id == TOKEN_WORD) {
+      id = classify_fixed_token(this->source.substr(this->cursor, 1));
+      length = 1;
     }
 
-    if (handled_special_char && this->tokens.size() > 0) {
-      Token last_added = this->tokens[this->tokens.size() - 1];
-      this->tokens.pop_back();
-      this->push_token(TOKEN_WORD, prev_buffer);
-      this->push_token(last_added.id, last_added.value);
-    }
+    this->push_token(id, this->cursor, length);
+    this->cursor += length;
   }
 
-  if (this->in_string)
-    this->handle_string_char(' ');
-  if (this->in_number)
-    this->handle_number_char(' ');
-
-  this->tokens.push_back(Token(TOKEN_EOF, ""));
+  this->push_token(TOKEN_EOF, this->source.size(), 0);
+  // The estimate above is generous, and the tokens are kept until the
+  // parser is done with them.
+  this->tokens.shrink_to_fit();
 
   return this->tokens;
 }
 
-bool Lexer::handle_string_char(char c) {
-  if (this->buffer[this->buffer.length() - 2] == '\\') {
-    if (c == 'n')
-      this->buffer = this->buffer.substr(0, this->buffer.length() - 2) + '\n';
-
-    if (c == 'r')
-      this->buffer = this->buffer.substr(0, this->buffer.length() - 2) + '\r';
-
-    if (c == 't')
-      this->buffer = this->buffer.substr(0, this->buffer.length() - 2) + '\t';
-
-    if (c == 'v')
-      this->buffer = this->buffer.substr(0, this->buffer.length() - 2) + '\v';
+void Lexer::lex_string(char quote) {
+  // The token covers everything between the quotes, escape sequences are
+  // resolved later by whoever needs the string's value.
+  uint32_t start = ++this->cursor;
 
-    if (c == '\\')
-      this->buffer = this->buffer.substr(0, this->buffer.length() - 2) + '\\';
+  while (this->cursor < this->source.size() &&
+         this->source[this->cursor] != quote) {
+    if (this->source[this->cursor] == '\\')
+      ++this->cursor;
+    ++this->cursor;
   }
 
-  if (c != this->in_string_type)
-    return false;
+  uint32_t end = std::min<uint32_t>(this->cursor, this->source.size());
+  this->push_token(TOKEN_STRING, start, end - start);
 
-  this->in_string = false;
-
-  // The string is everything in the buffer except the
-  // last character, which is the closing quote.
-  this->push_token(TOKEN_STRING,
-                   this->buffer.substr(0, this->buffer.length() - 1));
-  return true;
+  // Skip the closing quote.
+  ++this->cursor;
 }
 
-bool Lexer::handle_number_char(char c) {
-  if (boom_utils::is_digit(c) || c == '.') {
-    return true;
-  }
+void Lexer::lex_number() {
+  uint32_t start = this->cursor;
+
+  while (this->cursor < this->source.size() &&
+         (boom_utils::is_digit(this->source[this->cursor]) ||
+          this->source[this->cursor] == '.'))
+    ++this->cursor;
 
-  // The number is everything in the buffer except the
-  // last character, which is the character that caused
-  // us to stop processing the number.
-  this->push_token(TOKEN_NUMBER,
-                   this->buffer.substr(0, this->buffer.length() - 1));
-  this->buffer = c;
-  this->in_number = false;
-  return false;
+  this->push_token(TOKEN_NUMBER, start, this->cursor - start);
 }
 
-void Lexer::clear_buffer() { this->buffer = ""; }
+void Lexer::lex_word() {
+  uint32_t start = this->cursor;
 
-void Lexer::push_token(TokenIdentifier id, std::string value) {
-  if (id == TOKEN_WORD && boom_utils::trim_string(value) == "") {
-    this->clear_buffer();
-    return;
+  while (this->cursor < this->source.size()) {
+    char c = this->source[this->cursor];
+    if (is_whitespace(c) || c == QUOTE_DOUBLE || c == QUOTE_SINGLE ||
+        is_special_char(c))
+      break;
+    ++this->cursor;
   }
 
-  this->tokens.push_back(Token(id, value));
-  this->clear_buffer();
+  uint32_t length = this->cursor - start;
+  std::string_view word = this->source.substr(start, length);
+  TokenIdentifier id = classify_fixed_token(word);
+
+  if (id == TOKEN_WORD)
+    this->tokens.push_word(start, this->interner->intern(word));
+  else
+    this->push_token(id, start, length);
 }
 
-void Lexer::handle_quote_char(char c) {
-  this->clear_buffer();
-  this->in_string = true;
-  if (c == '"')
-    this->in_string_type = QUOTE_DOUBLE;
-  else if (c == '\'')
-    this->in_string_type = QUOTE_SINGLE;
+void Lexer::push_token(TokenIdentifier id, uint32_t offset, uint32_t length) {
+  this->tokens.push(id, offset, length);
 }
@@ -1,41 +1,33 @@
-
 #pragma once
 
-#include <fstream>
-#include <iostream>
-#include <string>
-#include <vector>
+#include <cstdint>
+#include <string_view>
 
+#include "interner.h"
 #include "token.h"
+#include "token_stream.h"
 
 class Lexer {
 public:
-  Lexer(std::string source) {
-    this->source = source;
+  Lexer(std::string_view source, StringInterner *interner)
+      : source(source), interner(interner), tokens(source, interner) {
     this->cursor = 0;
   }
 
   ~Lexer() = default;
 
-  std::vector<Token> lex();
+  TokenStream &lex();
 
 private:
-  std::string source;
-  int cursor;
-  std::string buffer;
-
-  bool in_number;
-
-  bool in_string;
-  QUOTE_TYPE in_string_type;
-
-  std::vector<Token> tokens;
+  std::string_view source;
+  StringInterner *interner;
+  uint32_t cursor;
 
-  void clear_buffer();
+  TokenStream tokens;
 
-  bool handle_string_char(char c);
-  bool handle_number_char(char c);
-  void handle_quote_char(char c);
+  void lex_string(char quote);
+  void lex_number();
+  void lex_word();
 
-  void push_token(TokenIdentifier id, std::string value);
+  void push_token(TokenIdentifier id, uint32_t offset, uint32_t length);
 };
@@ -1,28 +1,341 @@
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <mutex>
+#include <optional>
+#include <set>
 #include <stdio.h>
 #include <string>
 #include <vector>
 
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/ThreadPool.h>
+
 #include "ast.h"
+#include "compile_error.h"
+#include "daemon.h"
+#include "flat_ast.h"
 #include "lexer.h"
 #include "orc_llvm.h"
 #include "parser.h"
+#include "sema.h"
+#include "session.h"
 #include "token.h"
 #include "utils.h"
 
-int main() {
-  std::string source;
-  boom_utils::read_source_file("./main.orc", &source);
-  Lexer lexer(source);
-  std::vector<Token> tokens = lexer.lex();
+static const char *USAGE =
+    "Usage: orc [-c] [-o output] [-O0|-O1|-O2|-O3] [-jN] [--time-passes] "
+    "[--stats] [--dump] [--cache-dir dir] [file.orc...]\n"
+    "       orc run [--lazy] [-O0|-O1|-O2|-O3] [-jN] [--time-passes] "
+    "[--stats] [--dump] [--cache-dir dir] [file.orc]\n"
+    "       orc --daemon socket [-jN] [--cache-dir dir]\n";
+
+static void print_flat_ast_stats(const FlatAST &flat_ast) {
+  printf("flat ast: %zu nodes, %zu bytes\n", flat_ast.size(),
+         flat_ast.memory_usage());
+}
+
+/*
+  Lexes, parses and checks `path` and returns its flat AST. The AST does not
+  refer to the session, so everything else built on the way is released
+  here. With a cache directory, the AST of a source that was compiled
+  before is mapped from the cache instead, and a new one is saved to it.
+*/
+static FlatAST compile_source(const std::string &path,
+                              const std::string &cache_directory,
+                              bool print_stats) {
+  // Files compiled in parallel print their reports one at a time.
+  static std::mutex print_mutex;
+
+  CompilationSession session;
+  if (!session.source.open(path)) {
+    std::cout << "Error! Could not read source file `" << path << "`\n";
+    throw CompileError();
+  }
+
+  SourceKey key;
+  std::string cache_entry;
+  if (!cache_directory.empty()) {
+    key = FlatAST::source_key(session.source.view());
+
+    llvm::SmallString<128> entry(cache_directory);
+    llvm::sys::path::append(entry, llvm::toHex(key, true) + ".ast");
+    cache_entry = entry.str().str();
 
-  Parser parser(&tokens);
+    if (std::optional<FlatAST> cached = FlatAST::map(cache_entry, key)) {
+      if (print_stats) {
+        std::lock_guard<std::mutex> lock(print_mutex);
+        printf("--- Compile Stats ---\n");
+        printf("source: %s (ast cached)\n", path.c_str());
+        print_flat_ast_stats(*cached);
+      }
+      return std::move(*cached);
+    }
+  }
+
+  Lexer lexer(session.source.view(), &session.interner);
+  TokenStream &tokens = lexer.lex();
+
+  Parser parser(&tokens, &session);
   AST_Node *ast = parser.parse();
 
+  Sema sema(session.interner, session.types);
+  sema.check(ast);
+
+  FlatAST flat_ast = FlatAST::build(ast, session.interner);
+  if (!cache_entry.empty())
+    flat_ast.save(cache_entry, key);
+
+  if (print_stats) {
+    std::lock_guard<std::mutex> lock(print_mutex);
+
+    printf("--- Compile Stats ---\n");
+    printf("source: %s\n", path.c_str());
+    printf("tokens: %zu (%zu bytes, %.2f bytes/token)\n", tokens.size(),
+           tokens.memory_usage(), tokens.bytes_per_token());
+    session.print_stats();
+    printf("symbols: %zu\n", session.interner.size());
+    print_flat_ast_stats(flat_ast);
+  }
+
+  return flat_ast;
+}
+
+// `dir/name.orc` is compiled to `name.o` in the working directory, like cc.
+static std::string object_path_for(const std::string &source_path) {
+  return llvm::sys::path::stem(source_path).str() + ".o";
+}
+
+static void print_cache_stats(const OrcLLVM &olm) {
+  if (olm.cache_directory.empty())
+    return;
+
+  printf("cache: %zu hits, %zu misses\n", olm.cache_hits, olm.cache_misses);
+}
+
+// The driver proper, errors come out of it as a CompileError.
+static int compile_command(int argc, char **argv) {
+  std::vector<std::string> source_paths;
+  std::string output_path;
+  bool compile_only = false;
   OrcLLVM olm;
-  // olm.exec(ast);
-  olm.generate_binary(ast, "a.out");
+  bool print_stats = false;
+
+  // `orc run file.orc` JIT compiles the program and runs it in-process.
+  bool run_mode = argc > 1 && std::string(argv[1]) == "run";
+
+  for (int i = run_mode ? 2 : 1; i < argc; ++i) {
+    std::string arg = argv[i];
+
+    if (arg.size() == 3 && arg.starts_with("-O") && arg[2] >= '0' &&
+        arg[2] <= '3') {
+      olm.opt_level = arg[2] - '0';
+    } else if (arg == "--time-passes") {
+      olm.time_passes = true;
+    } else if (arg.starts_with("-j") &&
+               (arg.size() > 2 || i + 1 < argc)) {
+      // Worker threads, `-j8` or `-j 8`.
+      std::string count = arg.size() > 2 ? arg.substr(2) : argv[++i];
+      char *end = nullptr;
+      olm.jobs = std::strtoul(count.c_str(), &end, 10);
+      if (count.empty() || *end != '\0') {
+        std::cout << "Error! Invalid job count `" << count << "`\n";
+        return 1;
+      }
+    } else if (arg == "--stats") {
+      print_stats = true;
+    } else if (arg == "--dump") {
+      olm.dump = true;
+    } else if (run_mode && arg == "--lazy") {
+      olm.lazy = true;
+    } else if (!run_mode && arg == "-c") {
+      compile_only = true;
+    } else if (!run_mode && arg == "-o" && i + 1 < argc) {
+      output_path = argv[++i];
+    } else if (arg == "--cache-dir" && i + 1 < argc) {
+      olm.cache_directory = argv[++i];
+    } else if (arg.starts_with("-") && arg != "-") {
+      std::cout << "Error! Unknown option `" << arg << "`\n" << USAGE;
+      return 1;
+    } else {
+      source_paths.push_back(arg);
+    }
+  }
+
+  if (source_paths.empty())
+    source_paths.push_back("./main.orc");
+
+  if (!olm.cache_directory.empty()) {
+    std::error_code ec =
+        llvm::sys::fs::create_directories(olm.cache_directory);
+    if (ec) {
+      std::cout << "Error! Could not create cache directory `"
+                << olm.cache_directory << "`: " << ec.message() << "\n";
+      return 1;
+    }
+  }
+
+  if (run_mode && source_paths.size() > 1) {
+    std::cout << "Error! `orc run` takes a single source file.\n" << USAGE;
+    return 1;
+  }
+
+  if (compile_only && !output_path.empty() && source_paths.size() > 1) {
+    std::cout << "Error! `-o` cannot be used with `-c` and several source "
+                 "files.\n";
+    return 1;
+  }
+
+  if (run_mode) {
+    FlatAST flat_ast =
+        compile_source(source_paths[0], olm.cache_directory, print_stats);
+    return olm.run(flat_ast);
+  }
+
+  if (output_path.empty() && !compile_only)
+    output_path = "a.out";
+
+  if (source_paths.size() == 1) {
+    FlatAST flat_ast =
+        compile_source(source_paths[0], olm.cache_directory, print_stats);
+
+    if (compile_only) {
+      olm.generate_object(flat_ast, output_path.empty()
+                                        ? object_path_for(source_paths[0])
+                                        : output_path);
+    } else {
+      olm.generate_binary(flat_ast, output_path);
+    }
+
+    print_cache_stats(olm);
+    return 0;
+  }
+
+  if (compile_only) {
+    std::set<std::string> object_paths;
+    for (const std::string &path : source_paths) {
+      if (!object_paths.insert(object_path_for(path)).second) {
+        std::cout << "Error! Several source files would be compiled to `"
+                  << object_path_for(path) << "`\n";
+        return 1;
+      }
+    }
+  }
+
+  /*
+    Several files: each one is compiled on its own by a worker, with its
+    units generated on that worker, and --dump is ignored since the dumps
+    would interleave. Objects are linked in the order the files
+    were given.
+  */
+  std::vector<ObjectFiles> objects(source_paths.size());
+  std::vector<OrcLLVM> file_olms(source_paths.size());
+  // A file that fails does not stop the others, so every file's errors are
+  // reported, like cc does.
+  std::atomic<bool> failed = false;
+  llvm::ThreadPool pool(llvm::hardware_concurrency(olm.jobs));
+
+  for (size_t i = 0; i < source_paths.size(); ++i) {
+    pool.async([&, i] {
+      try {
+        FlatAST flat_ast =
+            compile_source(source_paths[i], olm.cache_directory, print_stats);
+
+        OrcLLVM &file_olm = file_olms[i];
+        file_olm.opt_level = olm.opt_level;
+        file_olm.time_passes = olm.time_passes;
+        file_olm.dump = false;
+        file_olm.jobs = 1;
+        file_olm.cache_directory = olm.cache_directory;
+
+        if (compile_only)
+          file_olm.generate_object(flat_ast, object_path_for(source_paths[i]));
+        else
+          objects[i] = file_olm.generate_objects(flat_ast);
+      } catch (const CompileError &) {
+        failed = true;
+      }
+    });
+  }
+  pool.wait();
+
+  if (failed) {
+    for (ObjectFiles &file_objects : objects)
+      file_objects.remove_temporaries();
+    return 1;
+  }
+
+  if (!compile_only) {
+    ObjectFiles all_objects;
+    for (ObjectFiles &file_objects : objects)
+      all_objects.append(file_objects);
+
+    OrcLLVM::link_executable(all_objects, output_path);
+  }
+
+  for (OrcLLVM &file_olm : file_olms) {
+    olm.cache_hits += file_olm.cache_hits;
+    olm.cache_misses += file_olm.cache_misses;
+  }
+  print_cache_stats(olm);
 
   return 0;
 }
+
+// Everything but --daemon, also what the daemon runs for each request.
+static int run_command(int argc, char **argv) {
+  try {
+    return compile_command(argc, argv);
+  } catch (const CompileError &) {
+    return 1;
+  }
+}
+
+/*
+  `orc --daemon socket` serves requests from orc_client, see daemon.h. -j
+  limits how many requests are compiled at once, --cache-dir is passed on
+  to every request that does not give its own.
+*/
+static int run_daemon(int argc, char **argv) {
+  if (argc < 3) {
+    std::cout << USAGE;
+    return 1;
+  }
+
+  unsigned jobs = 0;
+  std::vector<std::string> default_args;
+  for (int i = 3; i < argc; ++i) {
+    std::string arg = argv[i];
+
+    if (arg.starts_with("-j") && arg.size() > 2) {
+      char *end = nullptr;
+      jobs = std::strtoul(arg.c_str() + 2, &end, 10);
+      if (*end != '\0') {
+        std::cout << "Error! Invalid job count `" << arg.substr(2) << "`\n";
+        return 1;
+      }
+    } else if (arg == "--cache-dir" && i + 1 < argc) {
+      default_args = {arg, argv[++i]};
+    } else {
+      std::cout << "Error! Unknown option `" << arg << "`\n" << USAGE;
+      return 1;
+    }
+  }
+
+  CompilerDaemon daemon(
+      argv[2], llvm::hardware_concurrency(jobs).compute_thread_count(),
+      default_args, run_command);
+  return daemon.serve();
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && std::string(argv[1]) == "--daemon")
+    return run_daemon(argc, argv);
+
+  return run_command(argc, argv);
+}
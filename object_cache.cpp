@@ -0,0 +1,210 @@
+#include "object_cache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+
+#include "compile_error.h"
+
+/*
+  Bump whenever codegen changes the object code it produces for the same
+  AST, so entries written by older compilers are no longer found.
+*/
+static constexpr uint32_t CACHE_VERSION = 1;
+
+static void hash_u32(llvm::SHA1 &hasher, uint32_t value) {
+  uint8_t bytes[4] = {(uint8_t)value, (uint8_t)(value >> 8),
+                      (uint8_t)(value >> 16), (uint8_t)(value >> 24)};
+  hasher.update(bytes);
+}
+
+// Length first, so that consecutive strings cannot run into each other.
+static void hash_text(llvm::SHA1 &hasher, std::string_view text) {
+  hash_u32(hasher, text.size());
+  hasher.update(llvm::StringRef(text.data(), text.size()));
+}
+
+ObjectCache::ObjectCache(std::string directory, const FlatAST &ast,
+                         const ProgramSignatures &signatures,
+                         const llvm::TargetMachine &target_machine,
+                         unsigned opt_level)
+    : directory(std::move(directory)), ast(ast), signatures(signatures) {
+  std::error_code ec = llvm::sys::fs::create_directories(this->directory);
+  if (ec) {
+    std::cout << "Error! Could not create cache directory `"
+              << this->directory << "`: " << ec.message() << "\n";
+    throw CompileError();
+  }
+
+  std::span<const NodeIndex> top_level = ast.children(ast.node(ast.root()));
+  this->top_level.assign(top_level.begin(), top_level.end());
+
+  llvm::SHA1 hasher;
+  hash_u32(hasher, CACHE_VERSION);
+  hash_text(hasher, LLVM_VERSION_STRING);
+  hash_text(hasher, target_machine.getTargetTriple().str());
+  hash_text(hasher, target_machine.getTargetCPU().str());
+  hash_text(hasher, target_machine.getTargetFeatureString().str());
+  hash_u32(hasher, opt_level);
+
+  // Every unit defines all of the program's structs, see Codegen::emit_unit.
+  for (NodeIndex index : signatures.structs)
+    this->hash_nodes(hasher, index, this->end_of(index));
+
+  this->program_hash = hasher.final().str();
+}
+
+std::string ObjectCache::entry(NodeIndex function) const {
+  llvm::SHA1 hasher;
+  hasher.update(this->program_hash);
+  this->hash_nodes(hasher, function, this->end_of(function));
+
+  llvm::SmallString<128> path(this->directory);
+  llvm::sys::path::append(path, llvm::toHex(hasher.final(), true) + ".o");
+  return path.str().str();
+}
+
+bool ObjectCache::contains(const std::string &entry) {
+  return llvm::sys::fs::exists(entry);
+}
+
+std::string ObjectCache::reserve(const std::string &entry) {
+  llvm::SmallString<128> path;
+  int fd = -1;
+  std::error_code ec =
+      llvm::sys::fs::createUniqueFile(entry + ".tmp-%%%%%%%%", fd, path);
+  if (ec) {
+    std::cout << "Error! Could not create a file next to `" << entry
+              << "`: " << ec.message() << "\n";
+    throw CompileError();
+  }
+
+  llvm::sys::fs::closeFile(fd);
+  return path.str().str();
+}
+
+void ObjectCache::commit(const std::string &temporary,
+                         const std::string &entry) {
+  // Another compiler may have written the same entry meanwhile, both have
+  // the same contents so either one can win.
+  if (std::error_code ec = llvm::sys::fs::rename(temporary, entry)) {
+    llvm::sys::fs::remove(temporary);
+    std::cout << "Error! Could not write cache entry `" << entry
+              << "`: " << ec.message() << "\n";
+    throw CompileError();
+  }
+}
+
+// Nodes are stored in pre-order, so a top-level node's range of nodes runs
+// up to the next one.
+NodeIndex ObjectCache::end_of(NodeIndex top_level_node) const {
+  auto next = std::upper_bound(this->top_level.begin(), this->top_level.end(),
+                               top_level_node);
+  return next == this->top_level.end() ? this->ast.size() : *next;
+}
+
+void ObjectCache::hash_nodes(llvm::SHA1 &hasher, NodeIndex first,
+                             NodeIndex end) const {
+  // Child references are made relative to `first`.
+  auto hash_node = [&](NodeIndex index) {
+    hash_u32(hasher, index == NO_NODE ? NO_NODE : index - first);
+  };
+  auto hash_list = [&](uint32_t list_first, uint32_t count) {
+    hash_u32(hasher, count);
+    for (NodeIndex index : this->ast.list(list_first, count))
+      hash_node(index);
+  };
+
+  hash_u32(hasher, end - first);
+
+  for (NodeIndex index = first; index < end; ++index) {
+    const FlatNode &node = this->ast.node(index);
+    uint8_t header[3] = {node.kind, node.op, node.flags};
+    hasher.update(header);
+    this->hash_type(hasher, node.type);
+
+    switch (node.node_type()) {
+    case AST_NODE_INTEGER_LITERAL:
+      hash_u32(hasher, node.a);
+      break;
+    case AST_NODE_FLOAT_LITERAL:
+    case AST_NODE_STRING_LITERAL:
+      hash_text(hasher, this->ast.literal(node));
+      break;
+    case AST_NODE_VARIABLE_REFERENCE:
+      hash_text(hasher, this->ast.text(node.a));
+      break;
+    case AST_NODE_VARIABLE_DECLARATION:
+      hash_text(hasher, this->ast.text(node.a));
+      hash_node(node.b);
+      hash_text(hasher, this->ast.text(node.c));
+      break;
+    case AST_NODE_VARIABLE_ASSIGNMENT:
+      hash_text(hasher, this->ast.text(node.a));
+      hash_node(node.b);
+      break;
+    case AST_NODE_BLOCK:
+      hash_list(node.a, node.b);
+      hash_text(hasher, this->ast.text(node.c));
+      break;
+    case AST_FUNCTION_ARGUMENT:
+      hash_text(hasher, this->ast.text(node.a));
+      hash_text(hasher, this->ast.text(node.b));
+      break;
+    case AST_FUNCTION_DEFINITION:
+      hash_text(hasher, this->ast.text(node.a));
+      hash_list(node.b, node.c);
+      break;
+    case AST_FUNCTION_CALL:
+      hash_text(hasher, this->ast.text(node.a));
+      hash_list(node.b, node.c);
+      this->hash_signature(hasher, node.a);
+      break;
+    case AST_BINARY_OPERATION:
+    case AST_LOOP:
+      hash_node(node.a);
+      hash_node(node.b);
+      break;
+    case AST_CONDITIONAL:
+      hash_node(node.a);
+      hash_node(node.b);
+      hash_node(node.c);
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+void ObjectCache::hash_type(llvm::SHA1 &hasher, TypeIndex type) const {
+  // Array types are a chain of element types, struct fields are covered by
+  // the struct definitions.
+  for (; type != NO_TYPE; type = this->ast.type(type).element) {
+    const FlatType &flat_type = this->ast.type(type);
+    hasher.update(llvm::ArrayRef<uint8_t>(flat_type.kind));
+    hash_u32(hasher, flat_type.length);
+    hash_text(hasher, this->ast.text(flat_type.name));
+  }
+  hash_u32(hasher, NO_TYPE);
+}
+
+// The types a call to `function` is declared with, see
+// Codegen::declare_function.
+void ObjectCache::hash_signature(llvm::SHA1 &hasher, Symbol function) const {
+  const NodeIndex *index = this->signatures.function_nodes.find(function);
+  if (index == nullptr)
+    return;
+
+  const FlatNode &node = this->ast.node(*index);
+  std::span<const NodeIndex> items = this->ast.list(node.b, node.c);
+
+  this->hash_type(hasher, node.type);
+  for (NodeIndex arg : items.first(items.size() - 1))
+    this->hash_type(hasher, this->ast.node(arg).type);
+}
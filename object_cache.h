@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "llvm/Support/SHA1.h"
+#include "llvm/Target/TargetMachine.h"
+
+#include "codegen.h"
+#include "flat_ast.h"
+
+/*
+  On-disk cache of compiled functions, one object file per function. An
+  entry is named after a hash of everything its object code depends on: the
+  function's own nodes, the signatures of the functions it calls, the
+  program's struct definitions, the optimization level and the target. Names
+  and literals are hashed by their text and children by their position in
+  the function, so a function keeps its entry when code around it changes.
+
+  Entries are never modified once written, a changed function simply gets a
+  new one. They are written to a temporary file first and renamed into
+  place, so several compilers can share a cache directory.
+*/
+class ObjectCache {
+public:
+  ObjectCache(std::string directory, const FlatAST &ast,
+              const ProgramSignatures &signatures,
+              const llvm::TargetMachine &target_machine, unsigned opt_level);
+
+  // Path of the entry for function `function`, which may not exist yet.
+  std::string entry(NodeIndex function) const;
+  static bool contains(const std::string &entry);
+  // Creates a uniquely named file next to `entry` to write its object to
+  // before commit().
+  static std::string reserve(const std::string &entry);
+  static void commit(const std::string &temporary, const std::string &entry);
+
+private:
+  std::string directory;
+  const FlatAST &ast;
+  const ProgramSignatures &signatures;
+  // Hash of the target, the optimization level and the struct definitions,
+  // which every entry depends on.
+  std::string program_hash;
+  // Top-level nodes by index, with the end of their range of nodes.
+  std::vector<NodeIndex> top_level;
+
+  NodeIndex end_of(NodeIndex top_level_node) const;
+  void hash_nodes(llvm::SHA1 &hasher, NodeIndex first, NodeIndex end) const;
+  void hash_type(llvm::SHA1 &hasher, TypeIndex type) const;
+  void hash_signature(llvm::SHA1 &hasher, Symbol function) const;
+};
@@ -1,71 +1,690 @@
 #include "orc_llvm.h"
-#include "ast.h"
+#include "codegen.h"
+#include "compile_error.h"
+#include "object_cache.h"
+#include "runtime.h"
+#include <atomic>
 #include <cassert>
-#include <cstdlib>
+#include <cctype>
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <llvm/Support/raw_ostream.h>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <vector>
 
-#include <llvm/CodeGen/MachineFunction.h>
-#include <llvm/CodeGen/TargetSubtargetInfo.h>
-#include <llvm/MC/MCStreamer.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/PassInstrumentation.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/MC/TargetRegistry.h>
 #include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/Signals.h>
 #include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/ThreadPool.h>
 #include <llvm/Target/TargetMachine.h>
+#include <llvm/Target/TargetOptions.h>
 
-void OrcLLVM::exec(AST_Node *ast) {
-  printf("\n--- Generated AST ---\n");
-  ast->print();
+/*
+  Functions are grouped into units of about this many AST nodes. Units are
+  formed from the AST alone, so the generated code does not depend on the
+  number of threads that build it.
+*/
+static constexpr size_t UNIT_NODE_BUDGET = 4096;
 
-  this->module_init();
+void OrcLLVM::exec(const FlatAST &ast) {
+  if (this->dump) {
+    printf("\n--- Generated AST ---\n");
+    ast.print();
+  }
+
+  this->target_init();
+  this->signatures = ProgramSignatures::build(ast);
+  this->partition(ast);
+
+  this->for_each_unit(
+      [&](size_t i) { this->generate_unit(ast, this->units[i]); });
+
+  if (this->dump) {
+    printf("\n\n--- Generated IR ---\n");
+    // llvm::outs() does not go through stdio's buffer.
+    fflush(stdout);
+    for (CodegenUnit &unit : this->units)
+      unit.module->print(llvm::outs(), nullptr);
+  }
+}
+
+// Splits the program's functions, in source order, into units.
+void OrcLLVM::partition(const FlatAST &ast) {
+  std::span<const NodeIndex> functions = this->signatures.functions;
+  size_t first = 0;
+  size_t unit_nodes = 0;
+
+  this->units.clear();
+  this->cached_objects.clear();
+
+  if (!this->cache_directory.empty() && !functions.empty()) {
+    this->partition_cached(ast);
+    return;
+  }
+
+  // A program without functions still gets a unit, and an object file.
+  if (functions.empty())
+    this->units.emplace_back();
+
+  for (size_t i = 0; i < functions.size(); ++i) {
+    // Nodes are stored in pre-order, so a function's nodes run up to the
+    // next top-level node.
+    size_t end = i + 1 < functions.size() ? functions[i + 1] : ast.size();
+    unit_nodes += end - functions[i];
+
+    if (unit_nodes >= UNIT_NODE_BUDGET || i + 1 == functions.size()) {
+      CodegenUnit unit;
+      unit.functions = functions.subspan(first, i + 1 - first);
+      this->units.push_back(std::move(unit));
+      first = i + 1;
+      unit_nodes = 0;
+    }
+  }
+}
+
+/*
+  With the object cache, every function whose entry is missing becomes a
+  unit of its own, and the others are not generated at all. Functions are
+  compiled alone, so an entry only depends on its own function.
+*/
+void OrcLLVM::partition_cached(const FlatAST &ast) {
+  ObjectCache cache(this->cache_directory, ast, this->signatures,
+                    *this->target_machine, this->opt_level);
+  std::span<const NodeIndex> functions = this->signatures.functions;
+
+  for (size_t i = 0; i < functions.size(); ++i) {
+    std::string entry = cache.entry(functions[i]);
+    this->cached_objects.push_back(entry);
+
+    if (ObjectCache::contains(entry)) {
+      this->cache_hits += 1;
+      continue;
+    }
+
+    this->cache_misses += 1;
+    CodegenUnit unit;
+    unit.functions = functions.subspan(i, 1);
+    unit.cache_entry = entry;
+    this->units.push_back(std::move(unit));
+  }
+}
+
+void OrcLLVM::generate_unit(const FlatAST &ast, CodegenUnit &unit) {
+  unit.target_machine = this->create_target_machine();
+  unit.context = std::make_unique<llvm::LLVMContext>();
+  unit.module = std::make_unique<llvm::Module>("OrcLLVM", *unit.context);
+
+  // The module is generated directly for the host target, so the data layout
+  // has to be known before any code is emitted into it.
+  unit.module->setTargetTriple(unit.target_machine->getTargetTriple().str());
+  unit.module->setDataLayout(unit.target_machine->createDataLayout());
+
+  llvm::IRBuilder<> builder(*unit.context);
+  SymbolTable symbols;
+
+  // printf takes a format string and a variable number of arguments.
+  llvm::FunctionType *printf_type = llvm::FunctionType::get(
+      builder.getInt32Ty(), {builder.getInt8PtrTy()}, true);
+  unit.module->getOrInsertFunction("printf", printf_type);
+
+  Codegen codegen(ast, this->signatures, *unit.context, *unit.module, builder,
+                  symbols);
+  codegen.emit_unit(unit.functions);
+}
+
+unsigned OrcLLVM::thread_count() const {
+  return llvm::hardware_concurrency(this->jobs).compute_thread_count();
+}
+
+/*
+  Every call only touches its own unit, so the units come out in the same
+  order whichever thread finishes first. A single unit is handled on the
+  calling thread. An error in any unit is thrown again on the calling
+  thread once every worker is done.
+*/
+void OrcLLVM::for_each_unit(llvm::function_ref<void(size_t)> work) {
+  if (this->units.size() < 2 || this->thread_count() < 2) {
+    for (size_t i = 0; i < this->units.size(); ++i)
+      work(i);
+    return;
+  }
+
+  std::atomic<bool> failed = false;
+  llvm::ThreadPool pool(llvm::hardware_concurrency(this->jobs));
+  for (size_t i = 0; i < this->units.size(); ++i) {
+    pool.async([&work, &failed, i] {
+      try {
+        work(i);
+      } catch (const CompileError &) {
+        failed = true;
+      }
+    });
+  }
+  pool.wait();
+
+  if (failed)
+    throw CompileError();
+}
+
+void OrcLLVM::register_targets() {
+  // Target registration is process-wide, and several compilations can
+  // start at once.
+  static std::once_flag targets_registered;
+  std::call_once(targets_registered, [] {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+  });
+}
+
+void OrcLLVM::target_init() {
+  if (this->target_machine != nullptr)
+    return;
+
+  register_targets();
+  this->target_machine = this->create_target_machine();
+}
+
+/*
+  Target machines are not shared between threads, every unit is compiled
+  with one of its own.
+*/
+std::unique_ptr<llvm::TargetMachine> OrcLLVM::create_target_machine() {
+  std::string triple = llvm::sys::getDefaultTargetTriple();
+  std::string error;
+  const llvm::Target *target =
+      llvm::TargetRegistry::lookupTarget(triple, error);
+
+  if (target == nullptr) {
+    std::cout << "Error! Could not find target `" << triple << "`: " << error
+              << "\n";
+    throw CompileError();
+  }
+
+  llvm::CodeGenOpt::Level codegen_level = llvm::CodeGenOpt::None;
+  if (this->opt_level == 1)
+    codegen_level = llvm::CodeGenOpt::Less;
+  else if (this->opt_level == 2)
+    codegen_level = llvm::CodeGenOpt::Default;
+  else if (this->opt_level >= 3)
+    codegen_level = llvm::CodeGenOpt::Aggressive;
+
+  // Same defaults `llc` used to pick for us: generic CPU, no extra features,
+  // and a static relocation model since we link with -no-pie.
+  llvm::TargetOptions options;
+  std::unique_ptr<llvm::TargetMachine> target_machine(
+      target->createTargetMachine(triple, "generic", "", options,
+                                  llvm::Reloc::Static, llvm::None,
+                                  codegen_level));
+
+  if (target_machine == nullptr) {
+    std::cout << "Error! Could not create target machine for `" << triple
+              << "`\n";
+    throw CompileError();
+  }
+
+  return target_machine;
+}
+
+/*
+  Collects the wall time of every pass run by the new pass manager, keyed by
+  pass name in the order the passes first ran. Pass managers and adaptors are
+  timed as well (the callbacks have to stay balanced) but left out of the
+  report since their time is the sum of the passes nested in them.
+*/
+struct PassTimings {
+  struct Entry {
+    std::string name;
+    unsigned runs = 0;
+    double total_ms = 0;
+  };
+
+  std::vector<Entry> entries;
+  std::map<std::string, size_t> entry_index;
+  std::vector<std::chrono::steady_clock::time_point> running;
+
+  void register_callbacks(llvm::PassInstrumentationCallbacks &pic) {
+    pic.registerBeforeNonSkippedPassCallback(
+        [this](llvm::StringRef, llvm::Any) {
+          this->running.push_back(std::chrono::steady_clock::now());
+        });
+    pic.registerAfterPassCallback(
+        [this](llvm::StringRef name, llvm::Any,
+               const llvm::PreservedAnalyses &) { this->finish(name); });
+    pic.registerAfterPassInvalidatedCallback(
+        [this](llvm::StringRef name, const llvm::PreservedAnalyses &) {
+          this->finish(name);
+        });
+  }
+
+  void finish(llvm::StringRef name) {
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - this->running.back();
+    this->running.pop_back();
+
+    if (llvm::isSpecialPass(name, {"PassManager", "PassAdaptor"}))
+      return;
+
+    auto [it, inserted] =
+        this->entry_index.try_emplace(name.str(), this->entries.size());
+    if (inserted)
+      this->entries.push_back({name.str()});
+
+    this->entries[it->second].runs += 1;
+    this->entries[it->second].total_ms += elapsed.count();
+  }
+
+  // Adds the timings of `other`, which must have finished running.
+  void merge(const PassTimings &other) {
+    for (const Entry &entry : other.entries) {
+      auto [it, inserted] =
+          this->entry_index.try_emplace(entry.name, this->entries.size());
+      if (inserted)
+        this->entries.push_back({entry.name});
+
+      this->entries[it->second].runs += entry.runs;
+      this->entries[it->second].total_ms += entry.total_ms;
+    }
+  }
+
+  void print() {
+    // Several files can be compiled at once, keep each report in one piece.
+    static std::mutex print_mutex;
+    std::lock_guard<std::mutex> lock(print_mutex);
+
+    double total_ms = 0;
+    printf("\n--- Optimization Passes ---\n");
+    printf("%10s  %6s  %s\n", "time (ms)", "runs", "pass");
+    for (Entry &entry : this->entries) {
+      printf("%10.3f  %6u  %s\n", entry.total_ms, entry.runs,
+             entry.name.c_str());
+      total_ms += entry.total_ms;
+    }
+    printf("%10.3f  %6s  %s\n", total_ms, "", "total");
+  }
+};
+
+/*
+  Runs the default new-PM pipeline for `opt_level` over `module`. Shared by
+  optimize(), which runs it over every unit, and the lazy JIT, which
+  optimizes each function partition right before it is compiled.
+*/
+static void run_default_pipeline(llvm::Module &module,
+                                 llvm::TargetMachine *target_machine,
+                                 unsigned opt_level, PassTimings *timings) {
+  if (opt_level == 0)
+    return;
 
-  if (llvm_mod == nullptr || llvm_builder == nullptr || llvm_ctx == nullptr) {
-    std::cout << "One of the LLVM objects was not properly initialized.\n";
+  llvm::OptimizationLevel level = llvm::OptimizationLevel::O1;
+  if (opt_level == 2)
+    level = llvm::OptimizationLevel::O2;
+  else if (opt_level >= 3)
+    level = llvm::OptimizationLevel::O3;
+
+  llvm::PassInstrumentationCallbacks pic;
+  if (timings != nullptr)
+    timings->register_callbacks(pic);
+
+  // Match clang: loop and SLP vectorization are enabled from -O2 upwards.
+  llvm::PipelineTuningOptions tuning;
+  tuning.LoopVectorization = opt_level >= 2;
+  tuning.SLPVectorization = opt_level >= 2;
+
+  llvm::LoopAnalysisManager lam;
+  llvm::FunctionAnalysisManager fam;
+  llvm::CGSCCAnalysisManager cgam;
+  llvm::ModuleAnalysisManager mam;
+
+  llvm::PassBuilder pass_builder(target_machine, tuning, llvm::None, &pic);
+  pass_builder.registerModuleAnalyses(mam);
+  pass_builder.registerCGSCCAnalyses(cgam);
+  pass_builder.registerFunctionAnalyses(fam);
+  pass_builder.registerLoopAnalyses(lam);
+  pass_builder.crossRegisterProxies(lam, fam, cgam, mam);
+
+  llvm::ModulePassManager pass_manager =
+      pass_builder.buildPerModuleDefaultPipeline(level);
+  pass_manager.run(module, mam);
+}
+
+void OrcLLVM::optimize(PassTimings &timings) {
+  if (this->opt_level == 0)
     return;
+
+  // Each unit is timed on its own thread and the results merged in unit
+  // order.
+  std::vector<PassTimings> unit_timings(this->units.size());
+  this->for_each_unit([&](size_t i) {
+    run_default_pipeline(*this->units[i].module,
+                         this->units[i].target_machine.get(), this->opt_level,
+                         this->time_passes ? &unit_timings[i] : nullptr);
+  });
+
+  for (PassTimings &unit : unit_timings)
+    timings.merge(unit);
+}
+
+void OrcLLVM::emit_object(CodegenUnit &unit, const std::string &filename) {
+  std::error_code ec;
+  llvm::raw_fd_ostream output(filename, ec, llvm::sys::fs::OF_None);
+
+  if (ec) {
+    std::cout << "Error! Could not open `" << filename
+              << "` for writing: " << ec.message() << "\n";
+    throw CompileError();
   }
 
-  std::vector<llvm::Type *> printf_arg_types;
-  printf_arg_types.push_back(
-      llvm_builder->getInt8PtrTy()); // pointer to i8 for the format string
+  llvm::legacy::PassManager pass_manager;
+  if (unit.target_machine->addPassesToEmitFile(pass_manager, output, nullptr,
+                                               llvm::CGFT_ObjectFile)) {
+    std::cout << "Error! Target machine cannot emit object files.\n";
+    throw CompileError();
+  }
 
-  llvm::ArrayRef<llvm::Type *> arg_types(printf_arg_types);
-  llvm::FunctionType *printf_type =
-      llvm::FunctionType::get(llvm_builder->getInt32Ty(), arg_types,
-                              true); // the 'true' here means this function type
-                                     // takes a variable number of arguments
-  llvm::FunctionCallee printf_func =
-      llvm_mod->getOrInsertFunction("printf", printf_type);
+  pass_manager.run(*unit.module);
+  output.flush();
+}
 
-  for (AST_Node *i : ((AST_Block *)ast)->nodes) {
-    i->codegen(this->llvm_builder, this->llvm_ctx, this->llvm_mod,
-               this->variables);
+/*
+  Every file is created, and removed on a signal, before any unit is
+  emitted. On an error, all of them are removed again; the cache entries
+  already committed have been renamed away and stay.
+*/
+ObjectFiles OrcLLVM::emit_objects() {
+  ObjectFiles objects;
+  objects.paths = this->cached_objects;
+  ObjectFiles emitted;
+
+  try {
+    for (CodegenUnit &unit : this->units) {
+      if (!unit.cache_entry.empty()) {
+        emitted.paths.push_back(ObjectCache::reserve(unit.cache_entry));
+        emitted.add_temporary(emitted.paths.back());
+        continue;
+      }
+
+      llvm::SmallString<128> path;
+      if (llvm::sys::fs::createTemporaryFile("orc", "o", path)) {
+        std::cout << "Error! Could not create a temporary object file.\n";
+        throw CompileError();
+      }
+      emitted.paths.push_back(path.str().str());
+      emitted.add_temporary(emitted.paths.back());
+      objects.paths.push_back(emitted.paths.back());
+      objects.temporaries.push_back(emitted.paths.back());
+    }
+
+    this->for_each_unit([&](size_t i) {
+      this->emit_object(this->units[i], emitted.paths[i]);
+      if (!this->units[i].cache_entry.empty()) {
+        llvm::sys::DontRemoveFileOnSignal(emitted.paths[i]);
+        ObjectCache::commit(emitted.paths[i], this->units[i].cache_entry);
+      }
+    });
+  } catch (const CompileError &) {
+    emitted.remove_temporaries();
+    throw;
   }
 
-  printf("\n\n--- Generated IR ---\n");
-  this->llvm_mod->print(llvm::outs(), nullptr);
+  return objects;
 }
 
-void OrcLLVM::module_init() {
-  this->llvm_ctx = std::make_unique<llvm::LLVMContext>();
-  this->llvm_mod = std::make_unique<llvm::Module>("OrcLLVM", *this->llvm_ctx);
-  this->llvm_builder = std::make_unique<llvm::IRBuilder<>>(*this->llvm_ctx);
-  this->variables =
-      std::make_unique<std::map<std::string, VariableDefinition>>();
+void ObjectFiles::add_temporary(const std::string &path) {
+  this->temporaries.push_back(path);
+  llvm::sys::RemoveFileOnSignal(path);
 }
 
-void OrcLLVM::generate_binary(AST_Node *ast, std::string filename) {
+void ObjectFiles::remove_temporaries() const {
+  for (const std::string &path : this->temporaries) {
+    llvm::sys::fs::remove(path);
+    llvm::sys::DontRemoveFileOnSignal(path);
+  }
+}
+
+void ObjectFiles::append(const ObjectFiles &other) {
+  this->paths.insert(this->paths.end(), other.paths.begin(),
+                     other.paths.end());
+  this->temporaries.insert(this->temporaries.end(), other.temporaries.begin(),
+                           other.temporaries.end());
+}
+
+/*
+  Escapes `path` for a GNU response file, which splits on whitespace and
+  treats quotes and backslashes specially. A backslash makes any of them
+  literal, newlines included. A path starting with `@` would be read as
+  another response file, so it is given a `./` in front.
+*/
+static std::string response_file_escaped(llvm::StringRef path) {
+  std::string escaped = path.startswith("@") ? "./" : "";
+  for (char c : path) {
+    if (std::isspace((unsigned char)c) || c == '"' || c == '\'' || c == '\\')
+      escaped += '\\';
+    escaped += c;
+  }
+  return escaped;
+}
+
+/*
+  Runs `cc` with `flag` to link `objects` and then `inputs` into
+  `filename`, then removes the temporary objects. Everything but the flag
+  is passed in a response file, a program can have more objects than fit
+  on a command line. cc is run directly, no shell ever sees the paths.
+*/
+static void link_objects(llvm::StringRef flag, const ObjectFiles &objects,
+                         const std::vector<std::string> &inputs,
+                         const std::string &filename) {
+  llvm::ErrorOr<std::string> cc = llvm::sys::findProgramByName("cc");
+  if (!cc) {
+    objects.remove_temporaries();
+    std::cout << "Error! Could not find `cc` to link with.\n";
+    throw CompileError();
+  }
+
+  llvm::SmallString<128> response_path;
+  int fd = -1;
+  if (llvm::sys::fs::createTemporaryFile("orc", "rsp", fd, response_path)) {
+    objects.remove_temporaries();
+    std::cout << "Error! Could not create a temporary response file.\n";
+    throw CompileError();
+  }
+
+  {
+    llvm::raw_fd_ostream response(fd, true);
+    for (const std::string &path : objects.paths)
+      response << response_file_escaped(path) << "\n";
+    for (const std::string &path : inputs)
+      response << response_file_escaped(path) << "\n";
+    response << "-o\n" << response_file_escaped(filename) << "\n";
+  }
+
+  std::string response_arg = ("@" + response_path).str();
+  llvm::StringRef args[] = {"cc", flag, response_arg};
+  int link_status = llvm::sys::ExecuteAndWait(*cc, args);
+
+  llvm::sys::fs::remove(response_path);
+  objects.remove_temporaries();
+
+  if (link_status != 0) {
+    std::cout << "Error! Linking `" << filename << "` failed.\n";
+    throw CompileError();
+  }
+}
+
+void OrcLLVM::compile(const FlatAST &ast) {
+  PassTimings timings;
+
+  this->exec(ast);
+  this->optimize(timings);
+  if (this->time_passes && this->opt_level > 0)
+    timings.print();
+}
+
+ObjectFiles OrcLLVM::generate_objects(const FlatAST &ast) {
+  this->compile(ast);
+  return this->emit_objects();
+}
+
+void OrcLLVM::generate_object(const FlatAST &ast, std::string filename) {
+  this->compile(ast);
+
+  if (this->units.size() == 1 && this->cached_objects.empty()) {
+    this->emit_object(this->units[0], filename);
+    return;
+  }
+
+  // Units are compiled separately and combined into one relocatable object.
+  ObjectFiles objects = this->emit_objects();
+  link_objects("-r", objects, {}, filename);
+}
+
+void OrcLLVM::generate_binary(const FlatAST &ast, std::string filename) {
+  link_executable(this->generate_objects(ast), filename);
+}
+
+void OrcLLVM::link_executable(const ObjectFiles &objects,
+                              const std::string &filename) {
+  link_objects("-no-pie", objects, {ORC_RUNTIME_LIBRARY}, filename);
+}
+
+int OrcLLVM::run(const FlatAST &ast) {
+  // The JIT needs the IR of every function, cached objects are only linked.
+  this->cache_directory.clear();
   this->exec(ast);
 
-  std::string output_ir_str;
-  llvm::raw_string_ostream rso(output_ir_str);
-  this->llvm_mod->print(rso, nullptr);
-  rso.flush();
+  const NodeIndex *main_func = this->signatures.function_nodes.find(SYM_MAIN);
+  if (main_func == nullptr) {
+    std::cout << "Error! Function `main` not found!\n";
+    throw CompileError();
+  }
+  bool main_returns_int =
+      ast.type_of(ast.node(*main_func)).type_kind() == ORC_TYPE_INT;
+
+  auto exit_on_error = [](llvm::Error err) {
+    if (err) {
+      std::cout << "Error! " << llvm::toString(std::move(err)) << "\n";
+      throw CompileError();
+    }
+  };
+
+  llvm::orc::JITTargetMachineBuilder jtmb(
+      this->target_machine->getTargetTriple());
+  jtmb.setCodeGenOptLevel(this->target_machine->getOptLevel());
+
+  PassTimings timings;
+  // Target the lazy JIT optimizes its partitions for, which must outlive it.
+  std::unique_ptr<llvm::TargetMachine> partition_target;
+  // LLJIT's destructor is not virtual, so each kind of JIT is owned by a
+  // pointer of its own type and used through `jit`.
+  std::unique_ptr<llvm::orc::LLLazyJIT> owned_lazy_jit;
+  std::unique_ptr<llvm::orc::LLJIT> owned_eager_jit;
+  llvm::orc::LLJIT *jit = nullptr;
+
+  if (this->lazy) {
+    // Partitions are optimized for the machine the JIT compiles them for,
+    // not for the generic, static one object files are emitted with.
+    auto jit_target = jtmb.createTargetMachine();
+    exit_on_error(jit_target.takeError());
+    partition_target = std::move(*jit_target);
+
+    auto lazy_jit = llvm::orc::LLLazyJITBuilder()
+                        .setJITTargetMachineBuilder(std::move(jtmb))
+                        .create();
+    exit_on_error(lazy_jit.takeError());
+
+    // Only the functions that are actually called get emitted, each in its
+    // own partition, and every partition is optimized on its way down to
+    // the compile layer instead of optimizing the whole module up front.
+    (*lazy_jit)->setPartitionFunction(
+        llvm::orc::CompileOnDemandLayer::compileRequested);
+    (*lazy_jit)->getIRTransformLayer().setTransform(
+        [this, &timings, &partition_target](
+            llvm::orc::ThreadSafeModule partition,
+            const llvm::orc::MaterializationResponsibility &)
+            -> llvm::Expected<llvm::orc::ThreadSafeModule> {
+          partition.withModuleDo([&](llvm::Module &partition_mod) {
+            run_default_pipeline(partition_mod, partition_target.get(),
+                                 this->opt_level,
+                                 this->time_passes ? &timings : nullptr);
+          });
+          return partition;
+        });
+
+    for (CodegenUnit &unit : this->units)
+      exit_on_error((*lazy_jit)->addLazyIRModule(llvm::orc::ThreadSafeModule(
+          std::move(unit.module), std::move(unit.context))));
+    owned_lazy_jit = std::move(*lazy_jit);
+    jit = owned_lazy_jit.get();
+  } else {
+    this->optimize(timings);
+
+    // Units are compiled on the JIT's own threads as main's lookup pulls
+    // them in.
+    llvm::orc::LLJITBuilder builder;
+    builder.setJITTargetMachineBuilder(std::move(jtmb));
+    if (this->units.size() > 1 && this->thread_count() > 1)
+      builder.setNumCompileThreads(this->thread_count());
+
+    auto eager_jit = builder.create();
+    exit_on_error(eager_jit.takeError());
+    for (CodegenUnit &unit : this->units)
+      exit_on_error((*eager_jit)->addIRModule(llvm::orc::ThreadSafeModule(
+          std::move(unit.module), std::move(unit.context))));
+    owned_eager_jit = std::move(*eager_jit);
+    jit = owned_eager_jit.get();
+  }
+
+  // The output runtime is linked into the compiler, hand its addresses over.
+  auto runtime_symbol = [](auto *function) {
+    return llvm::JITEvaluatedSymbol(
+        llvm::pointerToJITTargetAddress(function),
+        llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable);
+  };
+  exit_on_error(jit->getMainJITDylib().define(llvm::orc::absoluteSymbols({
+      {jit->mangleAndIntern("orc_write"), runtime_symbol(&orc_write)},
+      {jit->mangleAndIntern("orc_write_string"),
+       runtime_symbol(&orc_write_string)},
+      {jit->mangleAndIntern("orc_write_int"), runtime_symbol(&orc_write_int)},
+      {jit->mangleAndIntern("orc_write_char"),
+       runtime_symbol(&orc_write_char)},
+      {jit->mangleAndIntern("orc_flush"), runtime_symbol(&orc_flush)},
+  })));
+
+  // Resolve libc symbols such as `printf` against the running process.
+  auto process_symbols =
+      llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+          jit->getDataLayout().getGlobalPrefix());
+  exit_on_error(process_symbols.takeError());
+  jit->getMainJITDylib().addGenerator(std::move(*process_symbols));
+
+  auto main_symbol = jit->lookup("main");
+  exit_on_error(main_symbol.takeError());
+
+  int exit_code = 0;
+  if (main_returns_int) {
+    auto *main_ptr = (int (*)())main_symbol->getAddress();
+    exit_code = main_ptr();
+  } else {
+    auto *main_ptr = (void (*)())main_symbol->getAddress();
+    main_ptr();
+  }
+
+  // Output the program buffered in the runtime comes before anything the
+  // compiler prints next.
+  orc_flush();
 
-  std::ofstream output_f_stream("out.ll");
-  output_f_stream << output_ir_str;
-  output_f_stream.close();
+  if (this->time_passes && this->opt_level > 0)
+    timings.print();
 
-  std::system("llc -filetype=obj out.ll -o out.o");
-  std::system("clang -no-pie out.o -o a.out");
+  return exit_code;
 }
@@ -1,24 +1,102 @@
 #pragma once
 
-#include <map>
 #include <memory>
+#include <span>
+#include <string>
+#include <vector>
 
-#include "ast.h"
-#include "llvm/IR/IRBuilder.h"
+#include "codegen.h"
+#include "flat_ast.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Target/TargetMachine.h"
+
+struct PassTimings;
+
+/*
+  One module's worth of the program: a contiguous run of its functions,
+  generated into a context of its own so units can be built, optimized and
+  compiled on different threads.
+*/
+struct CodegenUnit {
+  std::span<const NodeIndex> functions;
+  std::unique_ptr<llvm::TargetMachine> target_machine;
+  std::unique_ptr<llvm::LLVMContext> context;
+  std::unique_ptr<llvm::Module> module;
+  // Cache entry the unit's object is written to, empty for a temporary
+  // object.
+  std::string cache_entry;
+};
+
+// Object files to link into a program. Temporary ones are removed once
+// linked, the others are object cache entries.
+struct ObjectFiles {
+  std::vector<std::string> paths;
+  std::vector<std::string> temporaries;
+
+  // Adds a temporary file, which is also removed if a signal kills the
+  // compiler before remove_temporaries() does.
+  void add_temporary(const std::string &path);
+  void remove_temporaries() const;
+  void append(const ObjectFiles &other);
+};
 
 class OrcLLVM {
 public:
   OrcLLVM(){};
 
-  void exec(AST_Node *ast);
-  void module_init();
-  void generate_binary(AST_Node *ast, std::string filename);
+  void exec(const FlatAST &ast);
+  // Registers the native target with LLVM, once per process.
+  static void register_targets();
+  void target_init();
+  void optimize(PassTimings &timings);
+  // Compiles the program into object files, in source order.
+  ObjectFiles generate_objects(const FlatAST &ast);
+  void generate_object(const FlatAST &ast, std::string filename);
+  void generate_binary(const FlatAST &ast, std::string filename);
+  int run(const FlatAST &ast);
+
+  // Links `objects` and the output runtime into an executable, then removes
+  // the temporary ones.
+  static void link_executable(const ObjectFiles &objects,
+                              const std::string &filename);
+
+  // Optimization level (0-3) used for both the IR pipeline and codegen.
+  unsigned opt_level = 0;
+  // Print every pass that ran during optimize() and the time spent in it.
+  bool time_passes = false;
+  // In run mode, compile each function only when it is first called.
+  bool lazy = false;
+  // Print the AST and the generated IR while compiling, with --dump.
+  bool dump = false;
+  // Threads used to generate, optimize and compile units, 0 uses one per
+  // hardware thread.
+  unsigned jobs = 0;
+  // Directory of the object cache used by object file and executable
+  // builds, none if empty.
+  std::string cache_directory;
+  // Functions whose object was found in, or added to, the object cache.
+  size_t cache_hits = 0;
+  size_t cache_misses = 0;
 
 private:
-  std::unique_ptr<std::map<std::string, VariableDefinition>> variables;
-  std::unique_ptr<llvm::LLVMContext> llvm_ctx;
-  std::unique_ptr<llvm::Module> llvm_mod;
-  std::unique_ptr<llvm::IRBuilder<>> llvm_builder;
+  ProgramSignatures signatures;
+  std::vector<CodegenUnit> units;
+  std::unique_ptr<llvm::TargetMachine> target_machine;
+  // With the object cache, the entry of every function in source order.
+  std::vector<std::string> cached_objects;
+
+  std::unique_ptr<llvm::TargetMachine> create_target_machine();
+  // Generates and optimizes every unit.
+  void compile(const FlatAST &ast);
+  void partition(const FlatAST &ast);
+  void partition_cached(const FlatAST &ast);
+  void generate_unit(const FlatAST &ast, CodegenUnit &unit);
+  void emit_object(CodegenUnit &unit, const std::string &filename);
+  // Emits every unit to its cache entry or a temporary object file.
+  ObjectFiles emit_objects();
+  unsigned thread_count() const;
+  // Runs `work` on every unit index, spread over the worker threads.
+  void for_each_unit(llvm::function_ref<void(size_t)> work);
 };
@@ -1,16 +1,21 @@
 #include <algorithm>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <iterator>
 #include <vector>
 
 #include "ast.h"
+#include "compile_error.h"
 #include "parser.h"
+#include "session.h"
 #include "token.h"
+#include "utils.h"
 
-Parser::Parser(std::vector<Token> *tokens) {
+Parser::Parser(TokenStream *tokens, CompilationSession *session) {
   this->tokens = tokens;
+  this->session = session;
   this->cursor = 0;
   this->is_running = true;
 }
@@ -18,7 +23,7 @@ Parser::Parser(std::vector<Token> *tokens) {
 Parser::~Parser() {}
 
 AST_Node *Parser::parse() {
-  AST_Block *ast = new AST_Block();
+  AST_Block *ast = this->session->make_node<AST_Block>(&this->session->arena);
 
   for (;;) {
     AST_Node *node = this->parse_expr();
@@ -33,23 +38,28 @@ AST_Node *Parser::parse() {
 
 AST_FunctionDefinition *Parser::parse_function_definition() {
   ++this->cursor;
-  std::string f_name = this->current_token()->value;
+  Symbol f_name = this->current_token().symbol;
 
   ++this->cursor;
-  std::vector<AST_FunctionArgument *> f_args;
+  ArenaVector<AST_FunctionArgument *> f_args =
+      this->session->make_vector<AST_FunctionArgument *>();
   ++this->cursor;
 
-  if (this->current_token()->id == TOKEN_PAREN_CLOSE) {
+  if (this->current_token().id == TOKEN_PAREN_CLOSE) {
     this->cursor += 1;
   } else {
     for (;;) {
+      // An argument is a name, a type and a `,` or `)`.
+      this->expect_before_eof(this->cursor + 2,
+                              "`)` after the function arguments");
 
-      AST_FunctionArgument *arg = new AST_FunctionArgument(
-          this->current_token()->value, this->peek_next_token()->value);
+      AST_FunctionArgument *arg =
+          this->session->make_node<AST_FunctionArgument>(
+              this->current_token().symbol, this->peek_next_token().symbol);
 
       f_args.push_back(arg);
 
-      if (this->tokens->at(this->cursor + 2).id == TOKEN_PAREN_CLOSE) {
+      if (this->tokens->kind(this->cursor + 2) == TOKEN_PAREN_CLOSE) {
         this->cursor += 3;
         break;
       }
@@ -58,329 +68,420 @@ AST_FunctionDefinition *Parser::parse_function_definition() {
     }
   }
 
-  std::string f_type = this->current_token()->value;
+  Symbol f_type = this->current_token().symbol;
   ++this->cursor;
 
   AST_Node *f_block = this->parse_expr();
 
   if (f_block->get_type() != AST_NODE_BLOCK) {
     std::cout << "Error: Function block must be a block" << std::endl;
-    exit(1);
+    throw CompileError();
   }
 
-  return new AST_FunctionDefinition(f_name, f_args, f_type,
-                                    (AST_Block *)f_block);
+  return this->session->make_node<AST_FunctionDefinition>(
+      f_name, std::move(f_args), f_type, (AST_Block *)f_block);
 }
 
 AST_FunctionCall *Parser::parse_function_call() {
-  std::string f_name = this->current_token()->value;
+  Symbol f_name = this->current_token().symbol;
   ++this->cursor;
 
-  AST_Node *node = this->parse_expr();
-  std::vector<AST_Node *> f_args;
-
-  if (node->get_type() != AST_NODE_BLOCK) {
-    printf("Error: Function arguments must be a block\n");
-    exit(1);
-  }
-
-  AST_Block *block = (AST_Block *)node;
+  AST_Block *block = this->parse_block();
+  ArenaVector<AST_Node *> f_args = this->session->make_vector<AST_Node *>();
 
   for (AST_Node *n : block->nodes) {
     f_args.push_back(n);
   }
 
-  return new AST_FunctionCall(f_name, f_args);
+  return this->session->make_node<AST_FunctionCall>(f_name,
+                                                    std::move(f_args));
 }
 
 AST_VariableDeclaration *Parser::parse_variable_declaration() {
-  std::string v_name;
-  std::vector<Token> v_type_tokens;
-  int eq_sign_pos, end_pos;
-
-  for (size_t i = this->cursor + 1; i < this->tokens->size(); i++) {
-    Token t = this->tokens->at(i);
-
-    if (t.id == TOKEN_OPERATOR_EQUALS) {
-      v_name = this->tokens->at(this->cursor + 1).value;
-      eq_sign_pos = i;
-      v_type_tokens =
-          std::vector<Token>(this->tokens->begin() + this->cursor + 2,
-                             this->tokens->begin() + (i));
-    }
+  ++this->cursor;
+  Symbol v_name = this->current_token().symbol;
+  ++this->cursor;
 
-    if (t.id == TOKEN_SEMICOLON) {
-      end_pos = i;
-      break;
-    }
-  }
+  Symbol v_type = this->parse_type_name();
 
-  std::string v_type = "";
-  for (Token t : v_type_tokens) {
-    v_type += t.value;
+  if (this->current_token().id != TOKEN_OPERATOR_EQUALS) {
+    printf("Error! Variable `%s` must be initialized.\n",
+           std::string(this->session->interner.text(v_name)).c_str());
+    throw CompileError();
   }
-
-  this->cursor = eq_sign_pos + 1;
+  ++this->cursor;
 
   AST_VariableDeclaration *v =
-      new AST_VariableDeclaration(v_name, v_type, this->parse_expr());
+      this->session->make_node<AST_VariableDeclaration>(
+          v_name, v_type, this->parse_expression());
 
-  this->cursor = end_pos + 1;
+  if (this->current_token().id == TOKEN_SEMICOLON)
+    ++this->cursor;
 
   return v;
 }
 
+/*
+  A type name is written as one or more tokens, `int` or `int[]`, and ends at
+  the `=` of a declaration or at the `,` or `}` after a struct field. Returns
+  NO_SYMBOL when no type is written. Names made of several tokens are
+  interned straight from the source when the tokens are adjacent.
+*/
+Symbol Parser::parse_type_name() {
+  uint32_t start = this->cursor;
+  size_t length = 0;
+
+  for (;;) {
+    TokenIdentifier id = this->current_token().id;
+    if (id == TOKEN_OPERATOR_EQUALS || id == TOKEN_COMMA ||
+        id == TOKEN_SEMICOLON || id == TOKEN_BRACE_CLOSE || id == TOKEN_EOF)
+      break;
+
+    length += this->current_token().length;
+    ++this->cursor;
+  }
+
+  if (this->cursor == start)
+    return NO_SYMBOL;
+
+  Token first = this->tokens->at(start);
+  if (this->cursor == start + 1 && first.symbol != NO_SYMBOL)
+    return first.symbol;
+
+  Token last = this->tokens->at(this->cursor - 1);
+  std::string_view span = this->tokens->get_source().substr(
+      first.offset, last.offset + last.length - first.offset);
+
+  if (span.size() == length)
+    return this->session->interner.intern(span);
+
+  std::string name;
+  for (uint32_t i = start; i < this->cursor; ++i)
+    name += this->tokens->text(i);
+  return this->session->interner.intern(name);
+}
+
 AST_VariableAssignment *Parser::parse_variable_assignment() {
-  Token *token = this->current_token();
-  std::string v_name = token->value;
+  Symbol v_name = this->current_token().symbol;
   this->cursor += 2;
   AST_VariableAssignment *v =
-      new AST_VariableAssignment(token->value, this->parse_expr());
-  this->cursor += 1;
+      this->session->make_node<AST_VariableAssignment>(v_name,
+                                                       this->parse_expr());
   return v;
 }
 
 AST_VariableReference *Parser::parse_variable_reference() {
-  Token *token = this->current_token();
+  Token token = this->current_token();
   this->cursor++;
-  return new AST_VariableReference(token->value);
-}
-
-AST_BinaryOperation *
-Parser::parse_binary_operation(std::vector<Token>::iterator op,
-                               std::vector<Token>::iterator end_of_op) {
-  AST_BinaryOperation *bin_op = new AST_BinaryOperation("", nullptr, nullptr);
-
-  return bin_op;
+  return this->session->make_node<AST_VariableReference>(token.symbol);
 }
 
 AST_Conditional *Parser::parse_conditional() {
   ++this->cursor;
-  AST_Block *condition = (AST_Block *)this->parse_expr();
+  AST_Node *condition = this->parse_expr();
   AST_Block *onTrueBlock = (AST_Block *)this->parse_expr();
-  AST_Block *onFalseBlock = new AST_Block();
+  AST_Block *onFalseBlock =
+      this->session->make_node<AST_Block>(&this->session->arena);
 
-  if (current_token()->value == "else") {
+  if (current_token().id == TOKEN_KEYWORD_ELSE) {
     ++this->cursor;
     onFalseBlock = (AST_Block *)this->parse_expr();
   }
 
   AST_Conditional *conditional =
-      new AST_Conditional(condition, onTrueBlock, onFalseBlock);
+      this->session->make_node<AST_Conditional>(condition, onTrueBlock,
+                                                onFalseBlock);
   return conditional;
 }
 
 AST_Loop *Parser::parse_while_loop() {
   ++this->cursor;
-  AST_Block *condition = (AST_Block *)this->parse_expr();
+  AST_Node *condition = this->parse_expr();
   AST_Block *expression = (AST_Block *)this->parse_expr();
-  AST_Loop *loop = new AST_Loop(condition, expression);
+  AST_Loop *loop =
+      this->session->make_node<AST_Loop>(condition, expression);
   return loop;
 }
 
-AST_Node *Parser::parse_binary_operation(AST_Node *lhs_op) {
-  if (current_token()->id < TOKEN_OPERATOR_PLUS)
-    return lhs_op;
+AST_Block *Parser::parse_struct_definition() {
+  ++this->cursor;
+  Symbol s_name = this->current_token().symbol;
 
-  bool should_skip_closing_token = current_token()->id == TOKEN_BRACKET_OPEN;
+  this->cursor += 2;
 
-  std::string op_id = current_token()->id == TOKEN_BRACKET_OPEN
-                          ? "index"
-                          : current_token()->value;
+  AST_Block *struct_def_block =
+      this->session->make_node<AST_Block>(&this->session->arena);
 
-  AST_BinaryOperation *bin_op = new AST_BinaryOperation(op_id, lhs_op, nullptr);
+  if (this->current_token().id == TOKEN_BRACE_CLOSE) {
+    this->cursor += 1;
+  } else {
 
-  ++this->cursor;
-  bin_op->right = this->parse_expr();
+    for (;;) {
+      AST_FunctionArgument *arg =
+          this->session->make_node<AST_FunctionArgument>(
+              current_token().symbol, NO_SYMBOL);
+      ++this->cursor;
 
-  if (should_skip_closing_token)
-    ++this->cursor;
+      arg->type = this->parse_type_name();
+      struct_def_block->nodes.push_back(arg);
+
+      if (this->current_token().id == TOKEN_COMMA)
+        ++this->cursor;
+
+      this->expect_before_eof(this->cursor, "`}` after the struct fields");
+      if (this->current_token().id == TOKEN_BRACE_CLOSE)
+        break;
+    }
+  }
+
+  struct_def_block->block_type = "struct";
+  struct_def_block->block_name = s_name;
 
-  return bin_op;
+  ++this->cursor;
+
+  return struct_def_block;
 }
 
-AST_Node *Parser::parse_expr() {
-  Token *token = this->current_token();
+/*
+  Binding power of every binary operator, higher binds tighter. Indexing and
+  field access are postfix operators parsed together with their operand, so
+  they never reach the operator stack.
+*/
+static const uint8_t BINARY_OP_PRECEDENCE[BINARY_OP_COUNT] = {
+    4, 4, 5, 5, 5, // + - * / %
+    3, 3, 2,       // < > ==
+    1,             // =
+    6, 6,          // index, accessor
+};
+
+// Whether `pending`, already on the operator stack, takes its right operand
+// before `next` is pushed. Only assignment is right-associative.
+static bool binds_before(BinaryOp pending, BinaryOp next) {
+  if (next == BINARY_OP_ASSIGN)
+    return BINARY_OP_PRECEDENCE[pending] > BINARY_OP_PRECEDENCE[next];
+  return BINARY_OP_PRECEDENCE[pending] >= BINARY_OP_PRECEDENCE[next];
+}
 
-  if (token == nullptr) {
-    AST_EOF *eof = new AST_EOF();
-    this->is_running = false;
-    return eof;
+/*
+  Every cycle of the recursive descent goes through parse_expr() or
+  parse_expression(), both count themselves here. Nesting is bounded so
+  deeply nested input is reported instead of overflowing the stack of the
+  parser or of the passes walking the AST after it.
+*/
+static const uint32_t MAX_NESTING_DEPTH = 8192;
+
+class NestingGuard {
+public:
+  NestingGuard(uint32_t &depth) : depth(depth) {
+    if (++this->depth > MAX_NESTING_DEPTH) {
+      printf("Error! Blocks and expressions are nested too deeply.\n");
+      throw CompileError();
+    }
   }
 
-  if (token->id == TOKEN_WORD) {
-    if (token->value == "var") {
-      return this->parse_variable_declaration();
-    } else if (this->peek_next_token()->id == TOKEN_OPERATOR_EQUALS) {
-      return this->parse_variable_assignment();
-    } else if (token->value == "func") {
-      return this->parse_function_definition();
-    } else if (token->value == "if") {
-      return this->parse_conditional();
-    } else if (token->value == "while") {
-      return this->parse_while_loop();
-    } else if (this->peek_next_token()->id == TOKEN_PERIOD) {
-      AST_VariableReference *lhs =
-          new AST_VariableReference(this->current_token()->value);
-      this->cursor += 2;
-
-      AST_BinaryOperation *accessor_op =
-          new AST_BinaryOperation("accessor", lhs, this->parse_expr());
-
-      return accessor_op;
-    } else if (token->value == "struct") {
-      ++this->cursor;
-      std::string s_name = this->current_token()->value;
+  ~NestingGuard() { --this->depth; }
 
-      this->cursor += 2;
-      std::vector<AST_FunctionArgument *> f_args;
+private:
+  uint32_t &depth;
+};
 
-      AST_Block *struct_def_block = new AST_Block();
+/*
+  Binary expressions are parsed by precedence climbing on explicit operand
+  and operator stacks, so a chain such as `a + b + ... + z` of any length
+  takes no native stack. Nested expressions share the stacks and only touch
+  the entries pushed above the base they started at.
+*/
+AST_Node *Parser::parse_expression() {
+  NestingGuard guard(this->depth);
+  size_t operator_base = this->operators.size();
 
-      if (this->current_token()->id == TOKEN_BRACE_CLOSE) {
-        this->cursor += 1;
-      } else {
+  this->operands.push_back(this->parse_operand());
 
-        for (;;) {
+  while (this->current_token().id >= TOKEN_OPERATOR_PLUS) {
+    BinaryOp op = binary_op_from_token(this->current_token().id);
 
-          AST_FunctionArgument *arg =
-              new AST_FunctionArgument(this->current_token()->value, "");
-          ++this->cursor;
+    while (this->operators.size() > operator_base &&
+           binds_before(this->operators.back(), op))
+      this->reduce_binary_operation();
 
-          std::string t_name = "";
+    // Only an assignment can still be pending in front of another one.
+    if (op == BINARY_OP_ASSIGN && this->operators.size() > operator_base) {
+      printf("Error! Assignments cannot be chained.\n");
+      throw CompileError();
+    }
 
-          bool should_exit = false;
+    this->operators.push_back(op);
+    ++this->cursor;
+    this->operands.push_back(this->parse_operand());
+  }
 
-          while (this->current_token()->id != TOKEN_COMMA) {
-            t_name += this->current_token()->value;
-            ++this->cursor;
+  while (this->operators.size() > operator_base)
+    this->reduce_binary_operation();
 
-            if (this->current_token()->id == TOKEN_BRACE_CLOSE) {
-              should_exit = true;
-              break;
-            }
-          }
+  AST_Node *node = this->operands.back();
+  this->operands.pop_back();
+  return node;
+}
 
-          arg->type = t_name;
+void Parser::reduce_binary_operation() {
+  AST_Node *right = this->operands.back();
+  this->operands.pop_back();
 
-          struct_def_block->nodes.push_back(arg);
+  AST_Node *&left = this->operands.back();
+  left = this->session->make_node<AST_BinaryOperation>(this->operators.back(),
+                                                       left, right);
+  this->operators.pop_back();
+}
 
-          if (should_exit)
-            break;
+// A primary followed by any number of `[index]` and `.field` suffixes.
+AST_Node *Parser::parse_operand() {
+  AST_Node *node = this->parse_primary();
 
-          ++this->cursor;
-        }
-      }
+  for (;;) {
+    if (current_token().id == TOKEN_PERIOD &&
+        peek_next_token().id == TOKEN_WORD) {
+      ++this->cursor;
+      node = this->session->make_node<AST_BinaryOperation>(
+          BINARY_OP_ACCESSOR, node, this->parse_variable_reference());
+    } else if (current_token().id == TOKEN_BRACKET_OPEN) {
+      ++this->cursor;
+      AST_Node *index = this->parse_expression();
 
-      struct_def_block->block_type = "struct";
-      struct_def_block->block_name = s_name;
+      if (current_token().id != TOKEN_BRACKET_CLOSE) {
+        printf("Error! Expected `]` after an array index.\n");
+        throw CompileError();
+      }
 
       ++this->cursor;
+      node = this->session->make_node<AST_BinaryOperation>(BINARY_OP_INDEX,
+                                                           node, index);
+    } else {
+      return node;
+    }
+  }
+}
 
-      return struct_def_block;
+AST_Node *Parser::parse_primary() {
+  Token token = this->current_token();
 
-    } else if (this->peek_next_token()->id == TOKEN_PAREN_OPEN) {
+  if (token.id == TOKEN_WORD) {
+    if (this->peek_next_token().id == TOKEN_PAREN_OPEN)
       return this->parse_function_call();
-    } else {
-      AST_VariableReference *var_ref = this->parse_variable_reference();
-      return this->parse_binary_operation(var_ref);
-    }
+    return this->parse_variable_reference();
   }
 
-  if (token->id == TOKEN_PAREN_OPEN) {
-    AST_Block *block = new AST_Block();
-    this->cursor++;
-    for (;;) {
-      AST_Node *node = this->parse_expr();
-      block->add_node(*node);
-      block->might_be_array = false;
+  if (token.id == TOKEN_PAREN_OPEN || token.id == TOKEN_BRACE_OPEN)
+    return this->parse_block();
 
-      if (node->get_type() == AST_NODE_EOF)
-        break;
-    }
+  if (token.id == TOKEN_NUMBER) {
+    std::string_view number = this->text(token);
+    ++this->cursor;
 
-    return this->parse_binary_operation(block);
-  }
+    if (number.find(".") != std::string_view::npos)
+      return this->session->make_node<AST_FloatLiteral>(
+          this->session->copy_string(number));
 
-  if (token->id == TOKEN_COMMA || token->id == TOKEN_SEMICOLON) {
-    this->cursor++;
-    return this->parse_expr();
+    return this->session->make_node<AST_IntegerLiteral>(
+        this->session->copy_string(number));
   }
 
-  if (token->id == TOKEN_PAREN_CLOSE || token->id == TOKEN_BRACE_CLOSE) {
+  if (token.id == TOKEN_STRING) {
+    AST_StringLiteral *s_node = this->session->make_node<AST_StringLiteral>(
+        this->session->copy_string(
+            boom_utils::unescape_string(this->text(token))));
     this->cursor++;
-    return new AST_EOF();
+    return s_node;
   }
 
-  if (token->id == TOKEN_BRACE_OPEN) {
-    AST_Block *block = new AST_Block();
-    this->cursor++;
-    for (;;) {
-      AST_Node *node = this->parse_expr();
-      block->add_node(*node);
+  AST_EOF *eof = this->session->eof();
+  this->is_running = false;
+  return eof;
+}
 
-      if (node->get_type() == AST_NODE_EOF)
-        break;
-    }
-    return block;
+// Parses a `( ... )` or `{ ... }` block. Its nodes are parsed up to the
+// closing token, which parse_expr() consumes and turns into the EOF node
+// that ends the block.
+AST_Block *Parser::parse_block() {
+  AST_Block *block = this->session->make_node<AST_Block>(&this->session->arena);
+  block->might_be_array = this->current_token().id == TOKEN_BRACE_OPEN;
+  ++this->cursor;
+
+  for (;;) {
+    while (this->current_token().id == TOKEN_COMMA ||
+           this->current_token().id == TOKEN_SEMICOLON)
+      this->cursor++;
+
+    this->expect_before_eof(this->cursor, block->might_be_array
+                                              ? "`}` to close a block"
+                                              : "`)` to close a block");
+
+    AST_Node *node = this->parse_expr();
+    block->add_node(*node);
+
+    if (node->get_type() == AST_NODE_EOF)
+      break;
   }
 
-  if (token->id == TOKEN_NUMBER) {
+  return block;
+}
 
-    if (token->value.find(".") != std::string::npos) {
-      AST_FloatLiteral *f_node = new AST_FloatLiteral(token->value);
-      ++this->cursor;
+AST_Node *Parser::parse_expr() {
+  NestingGuard guard(this->depth);
 
-      if (current_token()->id >= TOKEN_OPERATOR_PLUS) {
-        AST_BinaryOperation *bin_op =
-            new AST_BinaryOperation(current_token()->value, f_node, nullptr);
-        ++this->cursor;
-        bin_op->right = this->parse_expr();
-        return bin_op;
-      }
+  while (this->current_token().id == TOKEN_COMMA ||
+         this->current_token().id == TOKEN_SEMICOLON)
+    this->cursor++;
 
-      return f_node;
-    } else {
-      AST_IntegerLiteral *i_node = new AST_IntegerLiteral(token->value);
-      ++this->cursor;
+  Token token = this->current_token();
 
-      if (current_token()->id >= TOKEN_OPERATOR_PLUS) {
-        AST_BinaryOperation *bin_op =
-            new AST_BinaryOperation(current_token()->value, i_node, nullptr);
-        ++this->cursor;
-        bin_op->right = this->parse_expr();
-        return bin_op;
-      }
+  if (token.id == TOKEN_EOF) {
+    AST_EOF *eof = this->session->eof();
+    this->is_running = false;
+    return eof;
+  }
 
-      return i_node;
-    }
+  switch (token.id) {
+  case TOKEN_KEYWORD_VAR:
+    return this->parse_variable_declaration();
+  case TOKEN_KEYWORD_FUNC:
+    return this->parse_function_definition();
+  case TOKEN_KEYWORD_IF:
+    return this->parse_conditional();
+  case TOKEN_KEYWORD_WHILE:
+    return this->parse_while_loop();
+  case TOKEN_KEYWORD_STRUCT:
+    return this->parse_struct_definition();
+  default:
+    break;
   }
 
-  if (token->id == TOKEN_STRING) {
-    AST_StringLiteral *s_node = new AST_StringLiteral(token->value);
+  if (token.id == TOKEN_PAREN_CLOSE || token.id == TOKEN_BRACE_CLOSE) {
     this->cursor++;
-    return s_node;
+    return this->session->eof();
   }
 
-  AST_EOF *eof = new AST_EOF();
-  this->is_running = false;
-  return eof;
-}
+  if (token.id == TOKEN_WORD &&
+      this->peek_next_token().id == TOKEN_OPERATOR_EQUALS)
+    return this->parse_variable_assignment();
 
-Token *Parser::current_token() {
-  if (this->cursor >= this->tokens->size())
-    return nullptr;
-  return &this->tokens->at(this->cursor);
+  return this->parse_expression();
 }
 
-Token *Parser::peek_next_token() {
-  if (this->cursor + 1 >= this->tokens->size())
-    return nullptr;
-  return &this->tokens->at(this->cursor + 1);
+void Parser::expect_before_eof(size_t index, const char *expected) {
+  for (size_t i = this->cursor; i <= index; ++i) {
+    if (this->tokens->kind(i) == TOKEN_EOF) {
+      printf("Error! Expected %s before the end of the file.\n", expected);
+      throw CompileError();
+    }
+  }
 }
 
-Token *Parser::peek_prev_token() {
-  if (this->cursor - 1 < 0)
-    return nullptr;
-  return &this->tokens->at(this->cursor - 1);
+Token Parser::current_token() { return this->tokens->at(this->cursor); }
+
+Token Parser::peek_next_token() { return this->tokens->at(this->cursor + 1); }
+
+std::string_view Parser::text(Token token) { return this->tokens->text(token); }
+
+Token Parser::peek_prev_token() {
+  return this->tokens->at(this->cursor == 0 ? 0 : this->cursor - 1);
 }
@@ -1,25 +1,40 @@
 #pragma once
 
+#include <cstdint>
+#include <string_view>
 #include <vector>
 
 #include "ast.h"
+#include "session.h"
 #include "token.h"
+#include "token_stream.h"
 
 class Parser {
 public:
-  Parser(std::vector<Token> *tokens);
+  Parser(TokenStream *tokens, CompilationSession *session);
   ~Parser();
   AST_Node *parse();
 
 private:
   uint32_t cursor;
-  std::vector<Token> *tokens;
+  TokenStream *tokens;
+  CompilationSession *session;
   bool is_running;
+  uint32_t depth = 0;
+
+  // Operand and operator stacks of parse_expression().
+  std::vector<AST_Node *> operands;
+  std::vector<BinaryOp> operators;
 
   AST_Node *parse_expr();
 
-  AST_Node *parse_binary_operation(AST_Node *lhs_op);
+  AST_Node *parse_expression();
+  void reduce_binary_operation();
+  AST_Node *parse_operand();
+  AST_Node *parse_primary();
+  AST_Block *parse_block();
   AST_VariableDeclaration *parse_variable_declaration();
+  Symbol parse_type_name();
   AST_VariableAssignment *parse_variable_assignment();
   AST_VariableReference *parse_variable_reference();
   AST_FunctionDefinition *parse_function_definition();
@@ -27,11 +42,12 @@ private:
   AST_Conditional *parse_conditional();
   AST_Block *parse_struct_definition();
   AST_Loop *parse_while_loop();
-  AST_BinaryOperation *
-  parse_binary_operation(std::vector<Token>::iterator op,
-                         std::vector<Token>::iterator end_of_op);
 
-  Token *current_token();
-  Token *peek_next_token();
-  Token *peek_prev_token();
+  // Reports a file that ends where `expected` should have come.
+  void expect_before_eof(size_t index, const char *expected);
+
+  Token current_token();
+  Token peek_next_token();
+  Token peek_prev_token();
+  std::string_view text(Token token);
 };
@@ -0,0 +1,87 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "runtime.h"
+
+/*
+  Only plain libc is used here: binaries are linked with `cc`, without the
+  C++ runtime, so the buffer has no destructor and is flushed from atexit.
+*/
+
+static const size_t OUTPUT_BUFFER_SIZE = 16 * 1024;
+
+struct OutputBuffer {
+  char data[OUTPUT_BUFFER_SIZE];
+  size_t size;
+  bool flush_at_exit;
+};
+
+static thread_local OutputBuffer output;
+
+static void reserve(size_t length) {
+  if (!output.flush_at_exit) {
+    output.flush_at_exit = true;
+    atexit(orc_flush);
+  }
+
+  if (output.size + length > OUTPUT_BUFFER_SIZE)
+    orc_flush();
+}
+
+int32_t orc_write(const char *data, int32_t length) {
+  // The length comes from generated code as an i32, nothing is written for
+  // a negative one.
+  if (length < 0)
+    return 0;
+
+  reserve(length);
+
+  // Writes larger than the whole buffer skip it.
+  if ((size_t)length > OUTPUT_BUFFER_SIZE) {
+    fwrite(data, 1, length, stdout);
+    return length;
+  }
+
+  memcpy(output.data + output.size, data, length);
+  output.size += length;
+  return length;
+}
+
+int32_t orc_write_string(const char *string) {
+  return orc_write(string, strlen(string));
+}
+
+int32_t orc_write_int(int32_t value) {
+  char digits[11];
+  char *end = digits + sizeof(digits);
+  char *begin = end;
+
+  // Negate as unsigned so INT32_MIN does not overflow.
+  uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+  do {
+    *--begin = '0' + magnitude % 10;
+    magnitude /= 10;
+  } while (magnitude != 0);
+
+  if (value < 0)
+    *--begin = '-';
+
+  return orc_write(begin, end - begin);
+}
+
+int32_t orc_write_char(int32_t c) {
+  reserve(1);
+  output.data[output.size++] = (char)c;
+  return 1;
+}
+
+// Goes through stdio rather than write(2) so the runtime's output stays
+// ordered with output from printf fallbacks.
+void orc_flush() {
+  if (output.size == 0)
+    return;
+
+  fwrite(output.data, 1, output.size, stdout);
+  output.size = 0;
+}
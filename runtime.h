@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+  Output runtime for compiled orc programs. `printf` calls whose format string
+  is known at compile time are lowered into calls to these functions instead
+  of going through libc's format parser. Output is appended to a thread-local
+  buffer that is written to stdout in bulk when it fills up, when orc_flush()
+  is called and when the program exits. Every write returns the number of
+  bytes it produced, so the lowered call can still return printf's result.
+
+  The runtime is linked into every binary the compiler produces and into the
+  compiler itself, which provides it to programs run in the JIT.
+*/
+extern "C" {
+int32_t orc_write(const char *data, int32_t length);
+int32_t orc_write_string(const char *string);
+int32_t orc_write_int(int32_t value);
+int32_t orc_write_char(int32_t c);
+void orc_flush();
+}
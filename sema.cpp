@@ -0,0 +1,635 @@
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+#include "compile_error.h"
+#include "sema.h"
+
+// Argument lists and blocks end in an EOF node, it is not part of the list.
+static size_t count_nodes(const ArenaVector<AST_Node *> &nodes) {
+  size_t count = 0;
+  while (count < nodes.size() && nodes[count]->get_type() != AST_NODE_EOF)
+    ++count;
+  return count;
+}
+
+Sema::Sema(const StringInterner &interner, TypeContext &types)
+    : interner(interner), types(types) {}
+
+void Sema::check(AST_Node *ast) {
+  this->push_scope();
+
+  for (AST_Node *node : ((AST_Block *)ast)->nodes) {
+    switch (node->get_type()) {
+    case AST_NODE_EOF:
+      break;
+    case AST_FUNCTION_DEFINITION:
+      this->check_function_definition((AST_FunctionDefinition *)node);
+      break;
+    case AST_NODE_BLOCK:
+      if (((AST_Block *)node)->block_type == "struct") {
+        this->check_struct_definition((AST_Block *)node);
+        break;
+      }
+      [[fallthrough]];
+    default:
+      printf("Error! Only functions and structs can be declared at the top "
+             "level.\n");
+      throw CompileError();
+    }
+  }
+
+  this->pop_scope();
+}
+
+/* Declarations */
+
+void Sema::check_struct_definition(AST_Block *block) {
+  if (this->structs.contains(block->block_name) ||
+      this->functions.contains(block->block_name)) {
+    printf("Error! `%s` is already defined.\n",
+           this->text(block->block_name).c_str());
+    throw CompileError();
+  }
+
+  StructInfo info;
+  info.type = this->types.struct_named(block->block_name);
+
+  for (AST_Node *node : block->nodes) {
+    AST_FunctionArgument *field = (AST_FunctionArgument *)node;
+    const OrcType *field_type = this->resolve_type_name(field->type);
+
+    if (field_type == nullptr || field_type->is_aggregate()) {
+      printf("Error! Field `%s` of struct `%s` must be an int or a string.\n",
+             this->text(field->name).c_str(),
+             this->text(block->block_name).c_str());
+      throw CompileError();
+    }
+
+    field->value_type = field_type;
+    info.field_names.push_back(field->name);
+    info.field_types.push_back(field_type);
+  }
+
+  block->value_type = this->types.void_type;
+  this->structs.insert(block->block_name) = std::move(info);
+}
+
+void Sema::check_function_definition(AST_FunctionDefinition *func) {
+  if (this->structs.contains(func->name) ||
+      this->functions.contains(func->name)) {
+    printf("Error! `%s` is already defined.\n", this->text(func->name).c_str());
+    throw CompileError();
+  }
+
+  FunctionInfo info;
+  info.return_type = func->return_type == SYM_VOID
+                         ? this->types.void_type
+                         : this->resolve_type_name(func->return_type);
+
+  if (info.return_type == nullptr) {
+    printf("Error! Unknown return type `%s` for function `%s`.\n",
+           this->text(func->return_type).c_str(),
+           this->text(func->name).c_str());
+    throw CompileError();
+  }
+
+  for (AST_FunctionArgument *arg : func->args) {
+    const OrcType *arg_type = this->resolve_type_name(arg->type);
+
+    if (arg_type == nullptr) {
+      printf("Error! Unknown type `%s` for argument `%s` of function `%s`.\n",
+             this->text(arg->type).c_str(), this->text(arg->name).c_str(),
+             this->text(func->name).c_str());
+      throw CompileError();
+    }
+
+    arg->value_type = arg_type;
+    info.arg_types.push_back(arg_type);
+  }
+
+  func->value_type = info.return_type;
+  this->current_function = func->name;
+  this->current_return_type = info.return_type;
+
+  // Registered before the body is checked so functions can recurse.
+  this->functions.insert(func->name) = info;
+
+  this->push_scope();
+  for (AST_FunctionArgument *arg : func->args)
+    this->define(arg->name, arg->value_type);
+  this->check_statements(func->body);
+  this->pop_scope();
+
+  this->current_function = NO_SYMBOL;
+  this->current_return_type = nullptr;
+}
+
+// A block whose nodes run one after another for their effects, like a
+// function body or the branches of a conditional.
+void Sema::check_statements(AST_Block *block) {
+  for (AST_Node *node : block->nodes) {
+    if (node->get_type() != AST_NODE_EOF)
+      this->check_expr(node);
+  }
+
+  block->value_type = this->types.void_type;
+}
+
+/* Expressions */
+
+const OrcType *Sema::check_expr(AST_Node *node) {
+  const OrcType *type = nullptr;
+
+  switch (node->get_type()) {
+  case AST_NODE_INTEGER_LITERAL:
+    type = this->types.int_type;
+    break;
+
+  case AST_NODE_STRING_LITERAL:
+    type = this->types.string_type;
+    break;
+
+  case AST_NODE_FLOAT_LITERAL:
+    printf("Error! Float literals are not supported yet.\n");
+    throw CompileError();
+
+  case AST_NODE_VARIABLE_REFERENCE: {
+    AST_VariableReference *ref = (AST_VariableReference *)node;
+    VariableInfo *info = this->lookup(ref->name);
+
+    if (info == nullptr) {
+      std::cout << "Variable `" << this->text(ref->name)
+                << "` not found in symbols table!\n";
+      throw CompileError();
+    }
+
+    type = info->type;
+    break;
+  }
+
+  case AST_NODE_VARIABLE_DECLARATION:
+    type = this->check_variable_declaration((AST_VariableDeclaration *)node);
+    break;
+
+  case AST_NODE_VARIABLE_ASSIGNMENT:
+    type = this->check_variable_assignment((AST_VariableAssignment *)node);
+    break;
+
+  case AST_NODE_BLOCK:
+    type = this->check_block((AST_Block *)node);
+    break;
+
+  case AST_FUNCTION_CALL:
+    type = this->check_function_call((AST_FunctionCall *)node);
+    break;
+
+  case AST_BINARY_OPERATION:
+    type = this->check_binary_operation((AST_BinaryOperation *)node);
+    break;
+
+  case AST_CONDITIONAL: {
+    AST_Conditional *conditional = (AST_Conditional *)node;
+
+    if (conditional->onTrue->get_type() != AST_NODE_BLOCK ||
+        conditional->onFalse->get_type() != AST_NODE_BLOCK) {
+      printf("Error! Both branches of an `if` must be blocks.\n");
+      throw CompileError();
+    }
+
+    this->check_condition(conditional->condition);
+
+    this->push_scope();
+    this->check_statements(conditional->onTrue);
+    this->pop_scope();
+
+    this->push_scope();
+    this->check_statements(conditional->onFalse);
+    this->pop_scope();
+
+    type = this->types.void_type;
+    break;
+  }
+
+  case AST_LOOP: {
+    AST_Loop *loop = (AST_Loop *)node;
+
+    if (loop->expression->get_type() != AST_NODE_BLOCK) {
+      printf("Error! The body of a `while` must be a block.\n");
+      throw CompileError();
+    }
+
+    this->check_condition(loop->condition);
+
+    this->push_scope();
+    this->check_statements(loop->expression);
+    this->pop_scope();
+
+    type = this->types.void_type;
+    break;
+  }
+
+  case AST_NODE_EOF:
+    printf("Error! Unexpected end of expression.\n");
+    throw CompileError();
+
+  default:
+    printf("Error! `%s` cannot be used as an expression.\n",
+           ast_node_type_name(node->get_type()));
+    throw CompileError();
+  }
+
+  node->value_type = type;
+  return type;
+}
+
+/*
+  A brace block whose elements are all ints, or all bools, is an array
+  literal. Any other block evaluates its nodes in order and takes the value
+  of the last one.
+*/
+const OrcType *Sema::check_block(AST_Block *block) {
+  size_t count = count_nodes(block->nodes);
+  const OrcType *element = nullptr;
+  bool is_array = block->might_be_array && count > 0;
+
+  for (size_t i = 0; i < count; ++i) {
+    const OrcType *type = this->check_expr(block->nodes[i]);
+
+    if (i == 0)
+      element = type;
+
+    if (type != element || (type->kind != ORC_TYPE_INT &&
+                            type->kind != ORC_TYPE_BOOL))
+      is_array = false;
+  }
+
+  block->is_array = is_array;
+  block->is_constant = is_array;
+
+  for (size_t i = 0; i < count && block->is_constant; ++i)
+    block->is_constant =
+        block->nodes[i]->get_type() == AST_NODE_INTEGER_LITERAL;
+
+  if (is_array)
+    return this->types.array_of(element, count);
+
+  return count == 0 ? this->types.void_type
+                    : block->nodes[count - 1]->value_type;
+}
+
+const OrcType *
+Sema::check_variable_declaration(AST_VariableDeclaration *decl) {
+  const OrcType *type = this->check_expr(decl->value);
+
+  if (type->kind == ORC_TYPE_VOID) {
+    printf("Error! Cannot initialize variable `%s` with a value of type "
+           "`void`.\n",
+           this->text(decl->name).c_str());
+    throw CompileError();
+  }
+
+  // The declared type is optional, when given it has to match the value.
+  std::string_view declared = this->interner.text(decl->type);
+  bool matches = true;
+
+  if (declared.ends_with("[]")) {
+    const OrcType *element = this->resolve_type_name(this->interner.lookup(
+        declared.substr(0, declared.size() - 2)));
+    matches = type->kind == ORC_TYPE_ARRAY && type->element == element;
+  } else if (!declared.empty()) {
+    matches = this->resolve_type_name(decl->type) == type;
+  }
+
+  if (!matches) {
+    printf("Error! Cannot initialize variable `%s` of type `%s` with a value "
+           "of type `%s`.\n",
+           this->text(decl->name).c_str(), std::string(declared).c_str(),
+           this->type_name(type).c_str());
+    throw CompileError();
+  }
+
+  this->define(decl->name, type, decl);
+  return this->types.void_type;
+}
+
+const OrcType *Sema::check_variable_assignment(AST_VariableAssignment *assign) {
+  VariableInfo *info = this->lookup(assign->name);
+
+  if (info == nullptr) {
+    printf("Error! Cannot assign to variable `%s` that was not previously "
+           "defined.\n",
+           this->text(assign->name).c_str());
+    throw CompileError();
+  }
+
+  const OrcType *var_type = info->type;
+  AST_VariableDeclaration *decl = info->decl;
+  const OrcType *type = this->check_expr(assign->value);
+
+  if (decl != nullptr)
+    decl->is_mutated = true;
+
+  if (type != var_type) {
+    printf("Error! Attempted to assign incompatible type to variable `%s`\n",
+           this->text(assign->name).c_str());
+    throw CompileError();
+  }
+
+  return this->types.void_type;
+}
+
+const OrcType *Sema::check_function_call(AST_FunctionCall *call) {
+  size_t arg_count = count_nodes(call->args);
+
+  std::vector<const OrcType *> arg_types;
+  for (size_t i = 0; i < arg_count; ++i)
+    arg_types.push_back(this->check_expr(call->args[i]));
+
+  /*
+    Return statements
+  */
+  if (call->name == SYM_RETURN) {
+    if (arg_count > 1) {
+      std::cout << "Error! Cannot return more than 1 value from a function.\n";
+      throw CompileError();
+    }
+
+    const OrcType *returned =
+        arg_count == 0 ? this->types.void_type : arg_types[0];
+
+    if (this->current_return_type == nullptr ||
+        returned != this->current_return_type) {
+      printf("Error! Function `%s` must return a value of type `%s`, not "
+             "`%s`.\n",
+             this->text(this->current_function).c_str(),
+             this->current_return_type == nullptr
+                 ? "void"
+                 : this->type_name(this->current_return_type).c_str(),
+             this->type_name(returned).c_str());
+      throw CompileError();
+    }
+
+    return this->types.void_type;
+  }
+
+  if (call->name == SYM_PRINTF) {
+    if (arg_count == 0 || arg_types[0]->kind != ORC_TYPE_STRING) {
+      std::cout << "Error while calling `printf`! First argument must always "
+                   "be the format string.\n";
+      throw CompileError();
+    }
+
+    return this->types.int_type;
+  }
+
+  /*
+    Struct initialization
+  */
+  if (StructInfo *info = this->structs.find(call->name)) {
+    if (arg_count != info->field_types.size()) {
+      printf("Error! Struct `%s` has %zu fields but %zu values were given.\n",
+             this->text(call->name).c_str(), info->field_types.size(),
+             arg_count);
+      throw CompileError();
+    }
+
+    for (size_t i = 0; i < arg_count; ++i) {
+      if (arg_types[i] != info->field_types[i]) {
+        printf("Error! Field `%s` of struct `%s` has type `%s`, not `%s`.\n",
+               this->text(info->field_names[i]).c_str(),
+               this->text(call->name).c_str(),
+               this->type_name(info->field_types[i]).c_str(),
+               this->type_name(arg_types[i]).c_str());
+        throw CompileError();
+      }
+    }
+
+    return info->type;
+  }
+
+  FunctionInfo *info = this->functions.find(call->name);
+
+  if (info == nullptr) {
+    std::cout << "Error! Function `" << this->text(call->name)
+              << "` not found!\n";
+    throw CompileError();
+  }
+
+  if (arg_count != info->arg_types.size()) {
+    printf("Error! Function `%s` expects %zu arguments but %zu were given.\n",
+           this->text(call->name).c_str(), info->arg_types.size(), arg_count);
+    throw CompileError();
+  }
+
+  for (size_t i = 0; i < arg_count; ++i) {
+    // Aggregates are passed by pointer, the callee may write to them.
+    if (arg_types[i]->is_aggregate())
+      this->mark_mutated(call->args[i]);
+
+    if (arg_types[i] != info->arg_types[i]) {
+      printf("Error! Argument %zu of `%s` must be of type `%s`, not `%s`.\n",
+             i + 1, this->text(call->name).c_str(),
+             this->type_name(info->arg_types[i]).c_str(),
+             this->type_name(arg_types[i]).c_str());
+      throw CompileError();
+    }
+  }
+
+  return info->return_type;
+}
+
+/*
+  The parser builds chains such as `a + b + ... + z` as a spine of left
+  operands. The spine is walked iteratively, innermost operation first, so
+  long machine-generated expressions do not exhaust the stack.
+*/
+const OrcType *Sema::check_binary_operation(AST_BinaryOperation *bin_op) {
+  size_t spine_base = this->spine.size();
+
+  this->spine.push_back(bin_op);
+  while (this->spine.back()->left->get_type() == AST_BINARY_OPERATION)
+    this->spine.push_back((AST_BinaryOperation *)this->spine.back()->left);
+
+  const OrcType *type = this->check_expr(this->spine.back()->left);
+
+  while (this->spine.size() > spine_base) {
+    AST_BinaryOperation *op = this->spine.back();
+    this->spine.pop_back();
+
+    type = this->check_binary_operator(op, type);
+    op->value_type = type;
+  }
+
+  return type;
+}
+
+const OrcType *Sema::check_binary_operator(AST_BinaryOperation *bin_op,
+                                           const OrcType *lhs) {
+  if (bin_op->op == BINARY_OP_ACCESSOR) {
+    StructInfo *info = lhs->kind == ORC_TYPE_STRUCT
+                           ? this->structs.find(lhs->name)
+                           : nullptr;
+
+    if (info == nullptr ||
+        bin_op->right->get_type() != AST_NODE_VARIABLE_REFERENCE) {
+      printf("Error, invalid accessor!\n");
+      throw CompileError();
+    }
+
+    Symbol field = ((AST_VariableReference *)bin_op->right)->name;
+
+    for (size_t i = 0; i < info->field_names.size(); ++i) {
+      if (info->field_names[i] == field) {
+        bin_op->right->value_type = info->field_types[i];
+        return info->field_types[i];
+      }
+    }
+
+    printf("Error! Struct `%s` has no field `%s`\n",
+           this->text(lhs->name).c_str(), this->text(field).c_str());
+    throw CompileError();
+  }
+
+  const OrcType *rhs = this->check_expr(bin_op->right);
+
+  switch (bin_op->op) {
+  case BINARY_OP_INDEX:
+    if (lhs->kind != ORC_TYPE_ARRAY || rhs->kind != ORC_TYPE_INT) {
+      printf("Error! Only arrays can be indexed, and only with an int.\n");
+      throw CompileError();
+    }
+    return lhs->element;
+
+  case BINARY_OP_ASSIGN: {
+    AST_Node *target = bin_op->left;
+    bool is_assignable =
+        target->get_type() == AST_NODE_VARIABLE_REFERENCE ||
+        (target->get_type() == AST_BINARY_OPERATION &&
+         (((AST_BinaryOperation *)target)->op == BINARY_OP_INDEX ||
+          ((AST_BinaryOperation *)target)->op == BINARY_OP_ACCESSOR));
+
+    if (!is_assignable || lhs != rhs) {
+      printf("Error! Invalid assignment of a `%s` to a `%s`.\n",
+             this->type_name(rhs).c_str(), this->type_name(lhs).c_str());
+      throw CompileError();
+    }
+
+    this->mark_mutated(target);
+    return this->types.void_type;
+  }
+
+  case BINARY_OP_ADD:
+  case BINARY_OP_SUBTRACT:
+  case BINARY_OP_MULTIPLY:
+  case BINARY_OP_DIVIDE:
+  case BINARY_OP_MODULO:
+    if (lhs->kind != ORC_TYPE_INT || rhs->kind != ORC_TYPE_INT) {
+      printf("Error! Operator `%s` expects int operands, not `%s` and "
+             "`%s`.\n",
+             binary_op_name(bin_op->op),
+             this->type_name(lhs).c_str(), this->type_name(rhs).c_str());
+      throw CompileError();
+    }
+    return this->types.int_type;
+
+  case BINARY_OP_LESS:
+  case BINARY_OP_GREATER:
+  case BINARY_OP_EQUALS:
+    if (lhs != rhs || (lhs->kind != ORC_TYPE_INT &&
+                       (lhs->kind != ORC_TYPE_BOOL ||
+                        bin_op->op != BINARY_OP_EQUALS))) {
+      printf("Error! Cannot compare `%s` with `%s` using `%s`.\n",
+             this->type_name(lhs).c_str(), this->type_name(rhs).c_str(),
+             binary_op_name(bin_op->op));
+      throw CompileError();
+    }
+    return this->types.bool_type;
+
+  default:
+    printf("Error! Unsupported operator `%s`.\n",
+           binary_op_name(bin_op->op));
+    throw CompileError();
+  }
+}
+
+// Conditions of `if` and `while` can be a bool or an int, non-zero ints are
+// true.
+const OrcType *Sema::check_condition(AST_Node *condition) {
+  const OrcType *type = this->check_expr(condition);
+
+  if (type->kind != ORC_TYPE_BOOL && type->kind != ORC_TYPE_INT) {
+    printf("Error! A condition must be a bool or an int, not `%s`.\n",
+           this->type_name(type).c_str());
+    throw CompileError();
+  }
+
+  return type;
+}
+
+/* Names and scopes */
+
+const OrcType *Sema::resolve_type_name(Symbol name) {
+  if (name == SYM_INT)
+    return this->types.int_type;
+
+  if (name == SYM_STRING)
+    return this->types.string_type;
+
+  if (StructInfo *info = this->structs.find(name))
+    return info->type;
+
+  return nullptr;
+}
+
+void Sema::push_scope() {
+  if (this->scope_depth == this->scopes.size())
+    this->scopes.emplace_back();
+  this->scope_depth += 1;
+}
+
+void Sema::pop_scope() {
+  this->scope_depth -= 1;
+  this->scopes[this->scope_depth].clear();
+}
+
+Sema::VariableInfo *Sema::lookup(Symbol name) {
+  for (size_t i = this->scope_depth; i > 0; --i) {
+    if (VariableInfo *info = this->scopes[i - 1].find(name))
+      return info;
+  }
+  return nullptr;
+}
+
+void Sema::define(Symbol name, const OrcType *type,
+                  AST_VariableDeclaration *decl) {
+  VariableInfo &info = this->scopes[this->scope_depth - 1].insert(name);
+  info.type = type;
+  info.decl = decl;
+}
+
+// Records that the storage at the root of `target`, e.g. `a` in `a[0]` or
+// `p.x`, is written to. Constant array literals written to in place lose
+// their constness so they get storage of their own.
+void Sema::mark_mutated(AST_Node *target) {
+  while (target->get_type() == AST_BINARY_OPERATION)
+    target = ((AST_BinaryOperation *)target)->left;
+
+  if (target->get_type() == AST_NODE_BLOCK)
+    ((AST_Block *)target)->is_constant = false;
+
+  if (target->get_type() != AST_NODE_VARIABLE_REFERENCE)
+    return;
+
+  VariableInfo *info = this->lookup(((AST_VariableReference *)target)->name);
+  if (info != nullptr && info->decl != nullptr)
+    info->decl->is_mutated = true;
+}
+
+std::string Sema::text(Symbol symbol) const {
+  return std::string(this->interner.text(symbol));
+}
+
+std::string Sema::type_name(const OrcType *type) const {
+  return this->types.name(type, this->interner);
+}
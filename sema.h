@@ -0,0 +1,86 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "ast.h"
+#include "interner.h"
+#include "symbol_map.h"
+#include "types.h"
+
+/*
+  Semantic pass run between parsing and codegen. It resolves every name,
+  checks that operands and arguments have compatible types and stores the
+  type of each expression in AST_Node::value_type, so codegen can lower
+  every node exactly once without inspecting the LLVM values it produced.
+  Errors are reported the same way as elsewhere in the compiler: a message
+  and a CompileError.
+*/
+class Sema {
+public:
+  Sema(const StringInterner &interner, TypeContext &types);
+
+  void check(AST_Node *ast);
+
+private:
+  struct StructInfo {
+    const OrcType *type = nullptr;
+    std::vector<Symbol> field_names;
+    std::vector<const OrcType *> field_types;
+  };
+
+  struct FunctionInfo {
+    const OrcType *return_type = nullptr;
+    std::vector<const OrcType *> arg_types;
+  };
+
+  const StringInterner &interner;
+  TypeContext &types;
+
+  SymbolMap<StructInfo> structs;
+  SymbolMap<FunctionInfo> functions;
+
+  struct VariableInfo {
+    const OrcType *type = nullptr;
+    // The declaration that introduced the variable, nullptr for arguments.
+    AST_VariableDeclaration *decl = nullptr;
+  };
+
+  // Variables, one map per lexical scope.
+  std::vector<SymbolMap<VariableInfo>> scopes;
+  size_t scope_depth = 0;
+
+  // Left operands of the binary operations being checked.
+  std::vector<AST_BinaryOperation *> spine;
+
+  Symbol current_function = NO_SYMBOL;
+  const OrcType *current_return_type = nullptr;
+
+  void check_struct_definition(AST_Block *block);
+  void check_function_definition(AST_FunctionDefinition *func);
+  void check_statements(AST_Block *block);
+
+  const OrcType *check_expr(AST_Node *node);
+  const OrcType *check_block(AST_Block *block);
+  const OrcType *check_variable_declaration(AST_VariableDeclaration *decl);
+  const OrcType *check_variable_assignment(AST_VariableAssignment *assign);
+  const OrcType *check_function_call(AST_FunctionCall *call);
+  const OrcType *check_binary_operation(AST_BinaryOperation *bin_op);
+  // Checks `bin_op` given the type of its already checked left operand.
+  const OrcType *check_binary_operator(AST_BinaryOperation *bin_op,
+                                       const OrcType *lhs);
+  const OrcType *check_condition(AST_Node *condition);
+
+  // Returns nullptr if `name` is not a known type.
+  const OrcType *resolve_type_name(Symbol name);
+
+  void push_scope();
+  void pop_scope();
+  VariableInfo *lookup(Symbol name);
+  void define(Symbol name, const OrcType *type,
+              AST_VariableDeclaration *decl = nullptr);
+  void mark_mutated(AST_Node *target);
+
+  std::string text(Symbol symbol) const;
+  std::string type_name(const OrcType *type) const;
+};
@@ -0,0 +1,32 @@
+#include <cstdio>
+
+#include "session.h"
+
+AST_EOF *CompilationSession::eof() {
+  if (this->shared_eof == nullptr)
+    this->shared_eof = this->make_node<AST_EOF>();
+  return this->shared_eof;
+}
+
+void CompilationSession::print_stats() {
+  size_t total_count = 0;
+  size_t total_bytes = 0;
+
+  printf("%-20s %10s %12s\n", "ast node", "count", "bytes");
+  for (size_t i = 0; i < AST_NODE_TYPE_COUNT; ++i) {
+    AST_NodeStats &stats = this->node_stats[i];
+    if (stats.count == 0)
+      continue;
+
+    printf("%-20s %10zu %12zu\n", ast_node_type_name((AST_Node_Type)i),
+           stats.count, stats.bytes);
+    total_count += stats.count;
+    total_bytes += stats.bytes;
+  }
+  printf("%-20s %10zu %12zu\n", "total", total_count, total_bytes);
+
+  printf("ast strings: %zu bytes\n", this->string_bytes);
+  printf("arena: %zu bytes used, %zu bytes reserved in %zu chunks\n",
+         this->arena.bytes_used(), this->arena.bytes_reserved(),
+         this->arena.chunk_count());
+}
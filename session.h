@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include <utility>
+
+#include "arena.h"
+#include "ast.h"
+#include "interner.h"
+#include "source_file.h"
+#include "types.h"
+
+struct AST_NodeStats {
+  size_t count = 0;
+  size_t bytes = 0;
+};
+
+/*
+  State owned by a single compilation: the input file, the arena every AST
+  node and AST string is allocated from, and the interner holding every
+  identifier, and the types Sema assigns to it. Destroying the session
+  releases the whole AST in one go.
+*/
+class CompilationSession {
+public:
+  CompilationSession() = default;
+
+  CompilationSession(const CompilationSession &) = delete;
+  CompilationSession &operator=(const CompilationSession &) = delete;
+
+  SourceFile source;
+  Arena arena;
+  StringInterner interner;
+  TypeContext types;
+
+  template <typename T, typename... Args> T *make_node(Args &&...args) {
+    T *node = this->arena.make<T>(std::forward<Args>(args)...);
+
+    AST_NodeStats &stats = this->node_stats[node->get_type()];
+    stats.count += 1;
+    stats.bytes += sizeof(T);
+
+    return node;
+  }
+
+  template <typename T> ArenaVector<T> make_vector() {
+    return ArenaVector<T>(&this->arena);
+  }
+
+  std::string_view copy_string(std::string_view str) {
+    this->string_bytes += str.size();
+    return this->arena.copy_string(str);
+  }
+
+  // Blocks and argument lists are terminated by an EOF node, they all share
+  // this one instance.
+  AST_EOF *eof();
+
+  void print_stats();
+
+private:
+  std::array<AST_NodeStats, AST_NODE_TYPE_COUNT> node_stats{};
+  size_t string_bytes = 0;
+  AST_EOF *shared_eof = nullptr;
+};
@@ -0,0 +1,75 @@
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "source_file.h"
+
+SourceFile::~SourceFile() {
+  if (this->mapped != nullptr)
+    munmap(this->mapped, this->mapped_size);
+}
+
+bool SourceFile::open(const std::string &path) {
+  if (path == "-")
+    return this->read_stream(STDIN_FILENO, 0);
+
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    close(fd);
+    return false;
+  }
+
+  // Empty files cannot be mapped, and there is nothing to read anyway.
+  if (S_ISREG(file_stat.st_mode) && file_stat.st_size == 0) {
+    close(fd);
+    return true;
+  }
+
+  if (S_ISREG(file_stat.st_mode)) {
+    void *mapping =
+        mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (mapping != MAP_FAILED) {
+      madvise(mapping, file_stat.st_size, MADV_SEQUENTIAL);
+      this->mapped = mapping;
+      this->mapped_size = file_stat.st_size;
+      close(fd);
+      return true;
+    }
+  }
+
+  bool read_ok = this->read_stream(
+      fd, S_ISREG(file_stat.st_mode) ? file_stat.st_size : 0);
+  close(fd);
+  return read_ok;
+}
+
+std::string_view SourceFile::view() const {
+  if (this->mapped != nullptr)
+    return std::string_view((const char *)this->mapped, this->mapped_size);
+  return this->buffer;
+}
+
+bool SourceFile::read_stream(int fd, size_t size_hint) {
+  this->buffer.clear();
+  this->buffer.reserve(size_hint);
+
+  char chunk[64 * 1024];
+  for (;;) {
+    ssize_t count = read(fd, chunk, sizeof(chunk));
+    if (count == 0)
+      return true;
+    if (count < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    this->buffer.append(chunk, count);
+  }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/*
+  Read-only view of an input file. Regular files are memory-mapped so the
+  lexer works directly on the page cache without copying the source. Pipes,
+  character devices and `-` (stdin) cannot be mapped and are streamed into
+  an owned buffer instead.
+*/
+class SourceFile {
+public:
+  SourceFile() = default;
+  ~SourceFile();
+
+  SourceFile(const SourceFile &) = delete;
+  SourceFile &operator=(const SourceFile &) = delete;
+
+  bool open(const std::string &path);
+  std::string_view view() const;
+  bool is_mapped() const { return this->mapped != nullptr; }
+
+private:
+  void *mapped = nullptr;
+  size_t mapped_size = 0;
+  std::string buffer;
+
+  bool read_stream(int fd, size_t size_hint);
+};
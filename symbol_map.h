@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "interner.h"
+
+/*
+  Open addressing hash map keyed by Symbol with linear probing. Symbols are
+  dense integers, so a multiplicative hash is enough to spread them. Values
+  are stored inline, which means pointers returned by find() and insert()
+  are only valid until the next insert().
+*/
+template <typename V> class SymbolMap {
+public:
+  SymbolMap() : keys(8, NO_SYMBOL), values(8) {}
+
+  V *find(Symbol symbol) {
+    size_t slot = this->find_slot(symbol);
+    return this->keys[slot] == symbol ? &this->values[slot] : nullptr;
+  }
+
+  const V *find(Symbol symbol) const {
+    size_t slot = this->find_slot(symbol);
+    return this->keys[slot] == symbol ? &this->values[slot] : nullptr;
+  }
+
+  bool contains(Symbol symbol) const { return this->find(symbol) != nullptr; }
+
+  // Returns the value stored for `symbol`, default constructing it first if
+  // the symbol is not in the map yet.
+  V &insert(Symbol symbol) {
+    size_t slot = this->find_slot(symbol);
+    if (this->keys[slot] == symbol)
+      return this->values[slot];
+
+    // Keep the table at most half full so probe sequences stay short.
+    if ((this->count + 1) * 2 > this->keys.size()) {
+      this->grow();
+      slot = this->find_slot(symbol);
+    }
+
+    this->keys[slot] = symbol;
+    this->count += 1;
+    return this->values[slot];
+  }
+
+  // Empties the map but keeps its capacity.
+  void clear() {
+    if (this->count == 0)
+      return;
+
+    for (size_t i = 0; i < this->keys.size(); ++i) {
+      if (this->keys[i] != NO_SYMBOL) {
+        this->keys[i] = NO_SYMBOL;
+        this->values[i] = V();
+      }
+    }
+    this->count = 0;
+  }
+
+  size_t size() const { return this->count; }
+
+private:
+  std::vector<Symbol> keys;
+  std::vector<V> values;
+  size_t count = 0;
+
+  size_t find_slot(Symbol symbol) const {
+    size_t mask = this->keys.size() - 1;
+    size_t slot = (symbol * 2654435761u) & mask;
+
+    while (this->keys[slot] != NO_SYMBOL && this->keys[slot] != symbol)
+      slot = (slot + 1) & mask;
+
+    return slot;
+  }
+
+  void grow() {
+    std::vector<Symbol> old_keys = std::move(this->keys);
+    std::vector<V> old_values = std::move(this->values);
+
+    this->keys.assign(old_keys.size() * 2, NO_SYMBOL);
+    this->values = std::vector<V>(old_keys.size() * 2);
+
+    for (size_t i = 0; i < old_keys.size(); ++i) {
+      if (old_keys[i] == NO_SYMBOL)
+        continue;
+
+      size_t slot = this->find_slot(old_keys[i]);
+      this->keys[slot] = old_keys[i];
+      this->values[slot] = std::move(old_values[i]);
+    }
+  }
+};
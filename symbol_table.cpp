@@ -0,0 +1,59 @@
+#include <cstdio>
+#include <cstdlib>
+
+#include "compile_error.h"
+#include "symbol_table.h"
+
+SymbolTable::SymbolTable() { this->push_scope(); }
+
+void SymbolTable::push_scope() {
+  if (this->scope_depth == this->scopes.size())
+    this->scopes.emplace_back();
+  this->scope_depth += 1;
+}
+
+void SymbolTable::pop_scope() {
+  if (this->scope_depth <= 1) {
+    printf("Error! Attempted to pop the global scope.\n");
+    throw CompileError();
+  }
+
+  this->scope_depth -= 1;
+  this->scopes[this->scope_depth].values.clear();
+  this->scopes[this->scope_depth].types.clear();
+  this->scopes[this->scope_depth].lifetimes.clear();
+}
+
+VariableDefinition *SymbolTable::lookup(Symbol symbol) {
+  for (size_t i = this->scope_depth; i > 0; --i) {
+    if (VariableDefinition *def = this->scopes[i - 1].values.find(symbol))
+      return def;
+  }
+  return nullptr;
+}
+
+VariableDefinition &SymbolTable::define(Symbol symbol) {
+  return this->scopes[this->scope_depth - 1].values.insert(symbol);
+}
+
+TypeDefinition *SymbolTable::lookup_type(Symbol symbol) {
+  for (size_t i = this->scope_depth; i > 0; --i) {
+    if (TypeDefinition *def = this->scopes[i - 1].types.find(symbol))
+      return def;
+  }
+  return nullptr;
+}
+
+TypeDefinition &SymbolTable::define_type(Symbol symbol) {
+  return this->scopes[this->scope_depth - 1].types.insert(symbol);
+}
+
+void SymbolTable::add_lifetime(llvm::AllocaInst *alloca) {
+  this->scopes[this->scope_depth - 1].lifetimes.push_back(alloca);
+}
+
+llvm::Constant *&SymbolTable::string_literal(std::string_view text) {
+  return this->strings.try_emplace(llvm::StringRef(text.data(), text.size()),
+                                   nullptr)
+      .first->second;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/IR/Constant.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Value.h"
+
+#include "interner.h"
+#include "symbol_map.h"
+
+/*
+  A named value. Scalars live in a stack slot: v_value is the slot and
+  v_type the type stored in it. Arrays and structs are bound to their
+  storage: v_value points to it and v_type is the aggregate type.
+*/
+struct VariableDefinition {
+  VariableDefinition() {}
+
+  VariableDefinition(llvm::Value *v_value, llvm::Type *v_type)
+      : v_value(v_value), v_type(v_type) {}
+
+  llvm::Value *v_value = nullptr;
+  llvm::Type *v_type = nullptr;
+};
+
+/*
+  A named type. Only structs can be declared, field_map gives the index of
+  every field by name.
+*/
+struct TypeDefinition {
+  llvm::StructType *s_type = nullptr;
+  SymbolMap<int> field_map;
+};
+
+/*
+  Lexically scoped symbol table used during codegen. Values and types live
+  in separate namespaces, so a struct and a variable can share a name.
+  Lookups search from the innermost scope outwards. Scopes are reused once
+  popped, so entering a function or block does not allocate after warm-up.
+  The table lives as long as the module being generated, which also makes it
+  the home of module-wide constants such as the string literal pool.
+*/
+class SymbolTable {
+public:
+  SymbolTable();
+
+  void push_scope();
+  void pop_scope();
+  size_t depth() const { return this->scope_depth; }
+
+  // Returns nullptr if `symbol` is not visible from the current scope.
+  VariableDefinition *lookup(Symbol symbol);
+  // Defines `symbol` in the innermost scope, shadowing any outer definition.
+  VariableDefinition &define(Symbol symbol);
+
+  TypeDefinition *lookup_type(Symbol symbol);
+  TypeDefinition &define_type(Symbol symbol);
+
+  // Stack slots whose lifetime ends when the innermost scope is left.
+  void add_lifetime(llvm::AllocaInst *alloca);
+  const std::vector<llvm::AllocaInst *> &lifetimes() const {
+    return this->scopes[this->scope_depth - 1].lifetimes;
+  }
+
+  // Pooled constant for a string literal, keyed by its contents. The slot is
+  // nullptr the first time a given string is seen.
+  llvm::Constant *&string_literal(std::string_view text);
+
+private:
+  struct Scope {
+    SymbolMap<VariableDefinition> values;
+    SymbolMap<TypeDefinition> types;
+    std::vector<llvm::AllocaInst *> lifetimes;
+  };
+
+  std::vector<Scope> scopes;
+  size_t scope_depth = 0;
+
+  llvm::StringMap<llvm::Constant *> strings;
+};
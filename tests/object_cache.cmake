@@ -0,0 +1,87 @@
+# Checks the object cache and the saved ASTs through the driver. Run by ctest
+# as `cmake -DORC=path/to/orc -DWORK_DIR=dir -P object_cache.cmake`.
+
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+set(PROGRAM [=[
+func helper(n int) void {
+    printf("helper %d\n", n);
+}
+
+func caller(n int) void {
+    helper(n + 1);
+}
+
+func square(n int) int {
+    return(n * n);
+}
+
+func main() int {
+    caller(1);
+    printf("%d\n", square(3));
+    return(0);
+}
+]=])
+
+# Runs orc with `args` on `source`, written to program.orc, and fails unless
+# it succeeds and prints `expected`. The output is left in `output`.
+function(run_orc source expected)
+  file(WRITE ${WORK_DIR}/program.orc "${source}")
+  execute_process(
+    COMMAND ${ORC} ${ARGN} program.orc
+    WORKING_DIRECTORY ${WORK_DIR}
+    OUTPUT_VARIABLE stdout
+    RESULT_VARIABLE result)
+
+  list(JOIN ARGN " " args)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "`orc ${args}` failed (${result}):\n${stdout}")
+  endif()
+  string(FIND "${stdout}" "${expected}" found)
+  if(found EQUAL -1)
+    message(FATAL_ERROR "`orc ${args}` did not print `${expected}`:\n${stdout}")
+  endif()
+  set(output "${stdout}" PARENT_SCOPE)
+endfunction()
+
+function(expect_entries count)
+  file(GLOB entries ${WORK_DIR}/cache/*.o)
+  list(LENGTH entries found)
+  if(NOT found EQUAL count)
+    message(FATAL_ERROR "Expected ${count} cache entries, found ${found}")
+  endif()
+endfunction()
+
+set(COMPILE -c -o program.o --cache-dir cache)
+
+# Every function is compiled once, then taken from the cache.
+run_orc("${PROGRAM}" "cache: 0 hits, 4 misses" ${COMPILE})
+expect_entries(4)
+run_orc("${PROGRAM}" "cache: 4 hits, 0 misses" ${COMPILE})
+expect_entries(4)
+
+# Editing the body of a function only invalidates that function.
+string(REPLACE "return(n * n);" "return(n * n * 1);" PROGRAM "${PROGRAM}")
+run_orc("${PROGRAM}" "cache: 3 hits, 1 misses" ${COMPILE})
+expect_entries(5)
+
+# Changing the signature of a function invalidates its callers as well, but
+# not main, which does not call it.
+string(REPLACE "helper(n int) void" "helper(n int) int" PROGRAM "${PROGRAM}")
+string(REPLACE "n);\n}\n\nfunc caller" "n);\n    return(n);\n}\n\nfunc caller"
+               PROGRAM "${PROGRAM}")
+run_orc("${PROGRAM}" "cache: 2 hits, 2 misses" ${COMPILE})
+expect_entries(7)
+
+# An AST mapped back from the cache prints and runs like the one it was
+# saved from.
+set(RUN run --dump --cache-dir ast_cache)
+run_orc("${PROGRAM}" "helper 2\n9\n" ${RUN})
+set(built "${output}")
+run_orc("${PROGRAM}" "(ast cached)" ${RUN} --stats)
+run_orc("${PROGRAM}" "helper 2\n9\n" ${RUN})
+if(NOT output STREQUAL built)
+  message(FATAL_ERROR "The mapped AST differs from the built one:\n"
+                      "${built}\n---\n${output}")
+endif()
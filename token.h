@@ -1,6 +1,9 @@
 #pragma once
 
-#include <string>
+#include <cstdint>
+#include <string_view>
+
+#include "interner.h"
 
 enum TokenIdentifier {
   TOKEN_ID,
@@ -20,6 +23,15 @@ enum TokenIdentifier {
   TOKEN_COMMA,
   TOKEN_SEMICOLON,
 
+  TOKEN_KEYWORD_VAR,
+  TOKEN_KEYWORD_FUNC,
+  TOKEN_KEYWORD_IF,
+  TOKEN_KEYWORD_ELSE,
+  TOKEN_KEYWORD_WHILE,
+  TOKEN_KEYWORD_STRUCT,
+
+  // Everything from here on is treated as a binary operator by the parser.
+
   TOKEN_OPERATOR_PLUS,
   TOKEN_OPERATOR_IS_EQUALS,
   TOKEN_OPERATOR_MINUS,
@@ -37,15 +49,24 @@ enum QUOTE_TYPE {
   QUOTE_DOUBLE = '"',
 };
 
+/*
+  A token does not own its text, it only records where in the source buffer
+  the text lives. For string tokens the range covers the characters between
+  the quotes, with escape sequences left as written. Identifiers also carry
+  the symbol they were interned as.
+*/
 class Token {
 public:
   TokenIdentifier id;
-  std::string value;
+  uint32_t offset;
+  uint32_t length;
+  Symbol symbol;
 
-  Token(TokenIdentifier id, std::string value) {
-    this->id = id;
-    this->value = value;
-  }
+  Token(TokenIdentifier id, uint32_t offset, uint32_t length,
+        Symbol symbol = NO_SYMBOL)
+      : id(id), offset(offset), length(length), symbol(symbol) {}
 
-  ~Token() = default;
+  std::string_view text(std::string_view source) const {
+    return source.substr(this->offset, this->length);
+  }
 };
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "interner.h"
+#include "token.h"
+
+/*
+  Token storage laid out as a structure of arrays: one byte for the kind and
+  four bytes each for the offset into the source and a payload, so a token
+  costs 9 bytes instead of a padded Token per element. The payload is the
+  token's length, except for identifiers where it is the interned symbol
+  (the length is the length of the symbol's text). The stream always ends
+  with a TOKEN_EOF token, reads past the end return that token.
+*/
+class TokenStream {
+public:
+  TokenStream(std::string_view source, const StringInterner *interner)
+      : source(source), interner(interner) {}
+
+  void reserve(size_t count) {
+    this->kinds.reserve(count);
+    this->offsets.reserve(count);
+    this->payloads.reserve(count);
+  }
+
+  // Gives back what reserve() set aside beyond the tokens actually pushed.
+  void shrink_to_fit() {
+    this->kinds.shrink_to_fit();
+    this->offsets.shrink_to_fit();
+    this->payloads.shrink_to_fit();
+  }
+
+  void push(TokenIdentifier id, uint32_t offset, uint32_t length) {
+    this->kinds.push_back((uint8_t)id);
+    this->offsets.push_back(offset);
+    this->payloads.push_back(length);
+  }
+
+  void push_word(uint32_t offset, Symbol symbol) {
+    this->kinds.push_back((uint8_t)TOKEN_WORD);
+    this->offsets.push_back(offset);
+    this->payloads.push_back(symbol);
+  }
+
+  size_t size() const { return this->kinds.size(); }
+
+  TokenIdentifier kind(size_t i) const {
+    return (TokenIdentifier)this->kinds[this->clamp(i)];
+  }
+
+  Token at(size_t i) const {
+    i = this->clamp(i);
+    TokenIdentifier id = (TokenIdentifier)this->kinds[i];
+
+    if (id == TOKEN_WORD) {
+      Symbol symbol = this->payloads[i];
+      return Token(id, this->offsets[i],
+                   this->interner->text(symbol).size(), symbol);
+    }
+
+    return Token(id, this->offsets[i], this->payloads[i]);
+  }
+
+  std::string_view text(size_t i) const {
+    i = this->clamp(i);
+    if (this->kinds[i] == TOKEN_WORD)
+      return this->interner->text(this->payloads[i]);
+    return this->source.substr(this->offsets[i], this->payloads[i]);
+  }
+
+  std::string_view text(Token token) const {
+    if (token.symbol != NO_SYMBOL)
+      return this->interner->text(token.symbol);
+    return token.text(this->source);
+  }
+
+  std::string_view get_source() const { return this->source; }
+
+  // Bytes held by the token arrays, 9 per token once the lexer is done.
+  size_t memory_usage() const {
+    return this->kinds.capacity() * sizeof(uint8_t) +
+           this->offsets.capacity() * sizeof(uint32_t) +
+           this->payloads.capacity() * sizeof(uint32_t);
+  }
+
+  double bytes_per_token() const {
+    return this->size() == 0 ? 0 : (double)this->memory_usage() / this->size();
+  }
+
+private:
+  std::string_view source;
+  const StringInterner *interner;
+  std::vector<uint8_t> kinds;
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> payloads;
+
+  size_t clamp(size_t i) const {
+    return i < this->kinds.size() ? i : this->kinds.size() - 1;
+  }
+};
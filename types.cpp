@@ -0,0 +1,66 @@
+#include "types.h"
+
+TypeContext::TypeContext() : storage(4 * 1024) {
+  this->void_type = this->make(ORC_TYPE_VOID);
+  this->int_type = this->make(ORC_TYPE_INT);
+  this->bool_type = this->make(ORC_TYPE_BOOL);
+  this->float_type = this->make(ORC_TYPE_FLOAT);
+  this->string_type = this->make(ORC_TYPE_STRING);
+}
+
+const OrcType *TypeContext::make(OrcTypeKind kind) {
+  OrcType *type = this->storage.make<OrcType>();
+  type->kind = kind;
+  return type;
+}
+
+const OrcType *TypeContext::array_of(const OrcType *element, uint32_t length) {
+  // Programs only ever use a handful of array types, a linear scan is fine.
+  for (const OrcType *type : this->arrays) {
+    if (type->element == element && type->length == length)
+      return type;
+  }
+
+  OrcType *type = this->storage.make<OrcType>();
+  type->kind = ORC_TYPE_ARRAY;
+  type->element = element;
+  type->length = length;
+  this->arrays.push_back(type);
+  return type;
+}
+
+const OrcType *TypeContext::struct_named(Symbol name) {
+  const OrcType *&type = this->structs.insert(name);
+
+  if (type == nullptr) {
+    OrcType *s_type = this->storage.make<OrcType>();
+    s_type->kind = ORC_TYPE_STRUCT;
+    s_type->name = name;
+    type = s_type;
+  }
+
+  return type;
+}
+
+std::string TypeContext::name(const OrcType *type,
+                              const StringInterner &interner) const {
+  switch (type->kind) {
+  case ORC_TYPE_VOID:
+    return "void";
+  case ORC_TYPE_INT:
+    return "int";
+  case ORC_TYPE_BOOL:
+    return "bool";
+  case ORC_TYPE_FLOAT:
+    return "float";
+  case ORC_TYPE_STRING:
+    return "string";
+  case ORC_TYPE_ARRAY:
+    return this->name(type->element, interner) + "[" +
+           std::to_string(type->length) + "]";
+  case ORC_TYPE_STRUCT:
+    return std::string(interner.text(type->name));
+  }
+
+  return "unknown";
+}
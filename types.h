@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "arena.h"
+#include "interner.h"
+#include "symbol_map.h"
+
+enum OrcTypeKind : uint8_t {
+  ORC_TYPE_VOID,
+  ORC_TYPE_INT,
+  ORC_TYPE_BOOL,
+  ORC_TYPE_FLOAT,
+  ORC_TYPE_STRING,
+  ORC_TYPE_ARRAY,
+  ORC_TYPE_STRUCT,
+};
+
+/*
+  The type of an Orc value as seen by the semantic pass. Types are uniqued by
+  their TypeContext, so two types are the same exactly when their pointers
+  are equal.
+*/
+struct OrcType {
+  OrcTypeKind kind;
+  // Element type and length of arrays.
+  const OrcType *element = nullptr;
+  uint32_t length = 0;
+  // Name of structs.
+  Symbol name = NO_SYMBOL;
+
+  // Arrays and structs live in memory and are passed around by pointer.
+  bool is_aggregate() const {
+    return this->kind == ORC_TYPE_ARRAY || this->kind == ORC_TYPE_STRUCT;
+  }
+};
+
+class TypeContext {
+public:
+  TypeContext();
+
+  TypeContext(const TypeContext &) = delete;
+  TypeContext &operator=(const TypeContext &) = delete;
+
+  const OrcType *void_type;
+  const OrcType *int_type;
+  const OrcType *bool_type;
+  const OrcType *float_type;
+  const OrcType *string_type;
+
+  const OrcType *array_of(const OrcType *element, uint32_t length);
+  const OrcType *struct_named(Symbol name);
+
+  std::string name(const OrcType *type, const StringInterner &interner) const;
+
+private:
+  Arena storage;
+  std::vector<const OrcType *> arrays;
+  SymbolMap<const OrcType *> structs;
+
+  const OrcType *make(OrcTypeKind kind);
+};
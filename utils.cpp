@@ -1,18 +1,6 @@
 #include "utils.h"
 
 namespace boom_utils {
-void read_source_file(std::string path, std::string *source) {
-  std::ifstream source_file;
-  source_file.open(path);
-  if (source_file.is_open()) {
-    std::string line;
-    while (getline(source_file, line))
-      *source += line + "\n";
-
-    source_file.close();
-  }
-}
-
 bool is_digit(char c) { return c >= '0' && c <= '9'; }
 
 std::string trim_string(std::string str) {
@@ -24,6 +12,45 @@ std::string trim_string(std::string str) {
                     last_non_whitespace - first_non_whitespace + 1);
 }
 
+std::string unescape_string(std::string_view str) {
+  std::string result;
+  result.reserve(str.size());
+
+  for (size_t i = 0; i < str.size(); i++) {
+    if (str[i] != '\\' || i + 1 == str.size()) {
+      result += str[i];
+      continue;
+    }
+
+    switch (str[++i]) {
+    case 'n':
+      result += '\n';
+      break;
+    case 'r':
+      result += '\r';
+      break;
+    case 't':
+      result += '\t';
+      break;
+    case 'v':
+      result += '\v';
+      break;
+    case '\\':
+    case '\'':
+    case '"':
+      result += str[i];
+      break;
+    default:
+      // Unknown escapes are kept as written.
+      result += '\\';
+      result += str[i];
+      break;
+    }
+  }
+
+  return result;
+}
+
 std::string indent_string(int indent) {
   std::string result = "";
   for (int i = 0; i < indent; i++)
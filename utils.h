@@ -2,10 +2,12 @@
 
 #include <fstream>
 #include <iostream>
+#include <string>
+#include <string_view>
 
 namespace boom_utils {
-void read_source_file(std::string path, std::string *source);
 bool is_digit(char c);
 std::string trim_string(std::string str);
+std::string unescape_string(std::string_view str);
 std::string indent_string(int indent);
 } // namespace boom_utils